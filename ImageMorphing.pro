@@ -4,69 +4,18 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+# fmg-core: the widget-free morphing, landmark and filter library (QtCore/QtGui only)
+# fmg-qt:   the graphical user interface, linking fmg-core and QtWidgets
+# fmg-cli:  the headless batch morphing executable, linking fmg-core only
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+TEMPLATE = subdirs
 
-TARGET = fmg-qt
-TEMPLATE = app
+SUBDIRS = core gui cli
 
-CONFIG += c++14 console
-
-# The following define makes your compiler emit warnings if you use
-# any feature of Qt which has been marked as deprecated (the exact warnings
-# depend on your compiler). Please consult the documentation of the
-# deprecated API in order to know how to port your code away from it.
-DEFINES += QT_DEPRECATED_WARNINGS
-
-# You can also make your code fail to compile if you use deprecated APIs.
-# In order to do so, uncomment the following line.
-# You can also select to disable deprecated APIs only up to a certain version of Qt.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-        main.cpp \
-        mainwindow.cpp \
-        databasepreview.cpp \
-        imagecontainer.cpp \
-        imageeditor.cpp \
-        scrollableqgroupbox.cpp \
-        resultspreview.cpp \
-        editorpane.cpp \
-        imageprocessor.cpp \
-        labelledslidergroup.cpp \
-        console.cpp \
-        morphdatabasedialog.cpp \
-        commandlinemorphing.cpp \
-        globals.cpp
-
-HEADERS += \
-        mainwindow.h \
-        databasepreview.h \
-        imagecontainer.h \
-        imageeditor.h \
-        scrollableqgroupbox.h \
-        resultspreview.h \
-        editorpane.h \
-        imageprocessor.h \
-        labelledslidergroup.h \
-        console.h \
-        morphdatabasedialog.h \
-        commandlinemorphing.h \
-        globals.h
-
-INCLUDEPATH += $$PWD/OpenBLAS/include
-LIBS += -L$$PWD/OpenBLAS/lib \
-        -lopenblas
-
-INCLUDEPATH += $$PWD/dlib_build/include
-LIBS += -L$$PWD/dlib_build/lib \
-        -ldlib
-
-INCLUDEPATH += $$PWD/opencv_build/include
-LIBS += -L$$PWD/opencv_build/x64/mingw/staticlib \
-        -lopencv_imgproc341 \
-        -lopencv_core341 \
-        -lzlib
+core.file = fmg-core.pro
 
+gui.file = fmg-qt.pro
+gui.depends = core
 
+cli.file = fmg-cli.pro
+cli.depends = core
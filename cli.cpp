@@ -0,0 +1,23 @@
+#include <QCoreApplication>
+
+#include "commandlinemorphing.h"
+
+#include <QCommandLineParser>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("fmg-cli");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Face Morph Generation tool, headless batch morphing of a directory of images.\n A json file can "
+                                     "be added to specify post-processing effects such as brightness / contrast increase or gaussian / bilateral "
+                                     "filtering.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    CommandLineMorphing::addOptions(parser);
+
+    parser.process(app);
+    return CommandLineMorphing::run(parser);
+}
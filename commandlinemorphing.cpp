@@ -1,369 +1,373 @@
 #include "commandlinemorphing.h"
 
-#include "globals.h"
-#include "imagecontainer.h"
-
-#include <algorithm>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QDirIterator>
+#include "morphcoordinator.h"
+#include "morphengine.h"
+#include "morphpreforker.h"
+#include "morphservice.h"
+#include "morphstream.h"
+#include "morphwatcher.h"
+#include "morphworker.h"
+#include "pixelkernels.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
 #include <QDebug>
-#include <QFile>
 #include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 /**
- * @brief CommandLineMorphing::CommandLineMorphing
+ * @brief CommandLineMorphing::addOptions
+ *
+ * Adds the input-directory, output-directory and settings options of the command line
+ * morphing procedure, the processes, resume, cache, memory-budget, encoder-threads, archive, shm, shm-timeout, shard, merge-manifests, watch and stream options, the coordinator
+ * and worker options of a distributed job, the daemon and connect options of the
+ * MorphService, and the self-test option, to the parser.
  *
- * The CommandLineMorphing ctor, the class is constructued
- * with three parameters containing relative/absolute file system paths
- * the image input-directory, the image output-directory as well as the
- * *.json settings file.
+ * @param parser the command line parser of the executable
+ */
+void CommandLineMorphing::addOptions(QCommandLineParser &parser)
+{
+    parser.addOption(QCommandLineOption(QStringList() << "i" << "input-directory",
+                                        "Specifies the directory, tar archive or list file (one image or archive per line) of the images to be morphed",
+                                        "directory"));
+    parser.addOption(QCommandLineOption(QStringList() << "o" << "output-directory",
+                                        "Specifies the target directory for the morphed results",
+                                        "directory"));
+    parser.addOption(QCommandLineOption(QStringList() << "s" << "settings",
+                                        "Specifies the json-formatted settings file, see MorphEngine::configure",
+                                        "file"));
+    parser.addOption(QCommandLineOption(QStringList() << "j" << "processes",
+                                        "Morphs the pairs in n forked worker processes sharing the model and the images",
+                                        "n"));
+    parser.addOption(QCommandLineOption(QStringList() << "r" << "resume",
+                                        "Skips the results recorded in the manifest of the output directory"));
+    parser.addOption(QCommandLineOption(QStringList() << "cache",
+                                        "Keeps the decoded images in the directory, later runs over the same images map them instead of decoding",
+                                        "directory"));
+    parser.addOption(QCommandLineOption(QStringList() << "memory-budget",
+                                        "Keeps at most the megabytes of decoded images in memory, the pairs are morphed in blocks which fit",
+                                        "megabytes"));
+    parser.addOption(QCommandLineOption(QStringList() << "encoder-threads",
+                                        "Encodes and saves the results on n threads while the next pairs are morphed, 0 to save after every morph",
+                                        "n"));
+    parser.addOption(QCommandLineOption(QStringList() << "archive",
+                                        "Packs the results into indexed tar files of at most the megabytes instead of one file per result",
+                                        "megabytes"));
+    parser.addOption(QCommandLineOption(QStringList() << "shm",
+                                        "Publishes the raw morphs into the POSIX shared memory ring of the name for a local consumer instead of saving them",
+                                        "name"));
+    parser.addOption(QCommandLineOption(QStringList() << "shm-slots",
+                                        "The amount of morphs the shared memory consumer may lag behind",
+                                        "n", "8"));
+    parser.addOption(QCommandLineOption(QStringList() << "shm-timeout",
+                                        "Fails the job once the shared memory consumer released no morph of a full ring within the seconds, 0 to wait as long as a consumer is attached and lives",
+                                        "seconds", "30"));
+    parser.addOption(QCommandLineOption(QStringList() << "shard",
+                                        "Produces only shard i of n of the pairs, e.g. 0/4, n processes produce all pairs",
+                                        "i/n"));
+    parser.addOption(QCommandLineOption(QStringList() << "merge-manifests",
+                                        "Combines the shard manifests of the directory into one manifest",
+                                        "directory"));
+    parser.addOption(QCommandLineOption(QStringList() << "w" << "watch",
+                                        "Keeps watching the input directory and morphs only the pairs of new images"));
+    parser.addOption(QCommandLineOption(QStringList() << "coordinator",
+                                        "Serves the job to worker processes connecting to the TCP port",
+                                        "port"));
+    parser.addOption(QCommandLineOption(QStringList() << "worker",
+                                        "Works on the job served by the coordinator at host:port",
+                                        "host:port"));
+    parser.addOption(QCommandLineOption(QStringList() << "stream",
+                                        "Morphs the length-prefixed image pairs read from stdin and writes the length-prefixed morphs to stdout"));
+    parser.addOption(QCommandLineOption(QStringList() << "d" << "daemon",
+                                        "Runs a resident morph service listening on the local socket name",
+                                        "name"));
+    parser.addOption(QCommandLineOption(QStringList() << "c" << "connect",
+                                        "Submits the job to the morph service listening on the local socket name",
+                                        "name"));
+    parser.addOption(QCommandLineOption(QStringList() << "self-test",
+                                        "Verifies the vectorized pixel kernels supported by the processor against their scalar reference"));
+}
+
+/**
+ * @brief CommandLineMorphing::run
  *
- * The ctor starts the following procedures: apply_settings(),
- * load_images() and morph_images().
+ * Runs one MorphEngine job with the options added by addOptions(), the settings file is
+ * optional. The help is shown if the input or output directory is missing. With the daemon
+ * option a MorphService is started instead, with the connect option the job is submitted
+ * to a running MorphService, and with the watch option the input directory is watched. The
+ * stream option morphs pairs from stdin to stdout, without input and output directories. The
+ * coordinator and worker options run a distributed job, see MorphCoordinator. The
+ * self-test option only verifies the pixel kernels, see selfTest().
  *
- * @param input_dir a directory path to the input images
- * @param output_dir a directory path to the output images
- * @param json_path a path to the *.json settings file
+ * @param parser the processed command line parser
+ * @return the process exit code, 0 on success
  */
-CommandLineMorphing::CommandLineMorphing(const QString &input_dir,
-                                         const QString &output_dir,
-                                         const QString &json_path) :
-    m_image_width(-1),
-    m_image_height(-1),
-    m_alpha(0.5),
-    m_h_filter(0),
-    m_g_filter(0),
-    m_m_filter(0),
-    m_b_filter(0),
-    m_transform(0),
-    m_sharpness(0),
-    m_contrast(0),
-    m_brightness(0),
-    m_allow_bad_morphs(false),
-    m_format(0)
+int CommandLineMorphing::run(QCommandLineParser &parser)
 {
-    QDir absolute_path_resolver;
-    m_input_directory = absolute_path_resolver.absoluteFilePath(input_dir);
-    m_output_directory = absolute_path_resolver.absoluteFilePath(output_dir);
-    if(!json_path.isEmpty()) {
-        m_json_path = absolute_path_resolver.absoluteFilePath(json_path);
-        auto settings_status = apply_settings();
-        if(!settings_status) {
-            qWarning() << "Failed to parse the json settings";
-            exit(1);
-        }
+    if(parser.isSet("self-test")) return selfTest();
+    if(parser.isSet("daemon")) return serve(parser.value("daemon"));
+    if(parser.isSet("worker")) return work(parser.value("worker"), parser.value("cache"));
+    if(parser.isSet("merge-manifests")) {
+        MorphEngine engine;
+        QObject::connect(&engine, &MorphEngine::message,
+                         [](const QString &text){qDebug().noquote() << text;});
+        if(engine.mergeManifests(parser.value("merge-manifests"))) return 0;
+        qWarning().noquote() << engine.errorString();
+        return 1;
+    }
+    if(parser.isSet("stream")) return stream(parser);
+    if(!parser.isSet("input-directory") || !parser.isSet("output-directory")) parser.showHelp(1);
+
+    if(parser.isSet("connect")) return submit(parser);
+    if(parser.isSet("watch")) return watch(parser);
+    if(parser.isSet("coordinator")) return coordinate(parser);
+
+    MorphEngine engine;
+    QObject::connect(&engine, &MorphEngine::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+
+    engine.setResume(parser.isSet("resume"));
+    engine.setCacheDirectory(parser.value("cache"));
+    engine.setMemoryBudget(parser.value("memory-budget").toLongLong() * 1024 * 1024);
+    if(parser.isSet("encoder-threads")) engine.setEncoderThreads(parser.value("encoder-threads").toInt());
+    engine.setArchiveOutput(parser.value("archive").toLongLong() * 1024 * 1024);
+    engine.setSharedMemoryOutput(parser.value("shm"), parser.value("shm-slots").toInt(),
+                                 parser.value("shm-timeout").toInt() * 1000);
+    bool ok = true;
+    if(parser.isSet("shard")) {
+        QStringList shard = parser.value("shard").split('/');
+        ok = shard.size() == 2 && engine.setShard(shard[0].toInt(), shard[1].toInt());
+        if(shard.size() != 2) qWarning().noquote() << "Invalid shard, expected i/n:" << parser.value("shard");
+    }
+    if(parser.isSet("settings")) {
+        qDebug() << "Applying the provided json settings";
+        ok = ok && engine.configure(parser.value("settings"));
+    }
+    ok = ok && engine.addImages(parser.value("input-directory"));
+    if(parser.isSet("processes")) {
+        MorphPreforker preforker(&engine);
+        QObject::connect(&preforker, &MorphPreforker::message,
+                         [](const QString &text){qDebug().noquote() << text;});
+        ok = ok && preforker.run(parser.value("output-directory"), parser.value("processes").toInt());
+    } else {
+        ok = ok && engine.run(parser.value("output-directory"));
+    }
+
+    for(const MorphResult &result : engine.results()) {
+        if(!result.error.isEmpty()) qWarning().noquote() << result.error;
     }
-    auto loading_status = load_images();
-    if(!loading_status) {
-        qWarning() << "Failed to load images";
-        exit(1);
+    if(!ok) {
+        qWarning().noquote() << engine.errorString();
+        return 1;
     }
-    morph_images();
-    qDebug() << "Morphing completed results saved to:" << m_output_directory;
-    exit(0);
+    qDebug() << "Morphing completed results saved to:" << parser.value("output-directory");
+    return 0;
 }
 
 /**
- * @brief CommandLineMorphing::apply_settings
- *
- * A procedure to apply the settings provided in the
- * *.json settings file.
- *
- * An example json file:
- * {
- *   "resolution": [-1, -1],
- *   "alpha": 0.5,
- *   "h-filter": 0,
- *   "g-filter": 0,
- *   "m-filter": 20,
- *   "b-filter": 100,
- *   "transform": 1,
- *   "sharpness": 30,
- *   "contrast": 40,
- *   "brightness": 50,
- *   "allow-bad-morphs": false,
- *   "format": 1
- * }
- *
- * please note that the json file MUST contain these and ONLY
- * these values.
- *
- * resolution: a 2d array specifying width and height, if
- * the values are -1, -1 it will automatically be determined
- * by the application.
- *
- * float alpha: RANGE: [0,1] a value controlling how much the resulting morph will
- * resmble reference one and two. 0.5 meaning both references are
- * valued equally in the alpha blending stage. Hence alpha=0 should
- * produce an output equal to reference-one image. alpha=1 should produce
- * an output equal to reference-two image.
- *
- * unsigned int h-filter: suggested RANGE: [0,100] a value controlling the amount
- * of homogenous smoothing added as a post-processing effect to the morphed
- * result. h-filter=0 implies that no homogenous smoothing will be added.
- * h-filter=100 results in a high intensity homogenous filtering.
+ * @brief CommandLineMorphing::watch
  *
- * unsigned int g-filter: suggested RANGE: [0,100] a value controlling the amount
- * of gaussian smoothing added as a post-processing effect to the morphed
- * result. g-filter=0 implies that no gaussian smoothing will be added.
- * g-filter=100 results in a high intensity gaussian filtering.
+ * Runs a MorphWatcher on the input directory until the process is terminated, requires a
+ * QCoreApplication.
  *
- * unsigned int m-filter: suggested RANGE: [0,100] a value controlling the amount
- * of median smoothing added as a post-processing effect to the morphed
- * result. m-filter=0 implies that no median smoothing will be added.
- * m-filter=100 results in a high intensity median filtering.
- *
- * unsigned int b-filter: suggested RANGE: [0,100] a value controlling the amount
- * of bilateral smoothing added as a post-processing effect to the morphed
- * result. b-filter=0 implies that no bilateral smoothing will be added.
- * b-filter=100 results in a high intensity bilateral filtering. WARNING: expensive
- *
- * unsigned int transform: suggested RANGE: [0,1], transform=0 will result in no transformation
- * added to the morphed results. transform=1 will result in a grayscaling transformation
- * of the morphed results.
- *
- * unsigned int sharpness: suggested RANGE: [0,100], a parameter controlling the
- * amount of sharpness added to the morphed results. sharpness=0 implies that no
- * sharpening effect will be added to the morphed results. sharpness=100 results
- * in a high intensity sharpness effect added to the morphed results.
- *
- * unsigned int contrast: suggested RANGE: [0,100], a parameter controlling the
- * amount of contrast added to the morphed results. contrast=0 implies that no
- * contrast will be added to the morphed results. contrast=100 results in a high
- * intensity contrast effect added to the morphed results.
- *
- * unsigned int brightness: suggested RANGE: [0,100], a parameter controlling the
- * amount of brightness added to the morphed results. brightness=0 implies that no
- * brightness will be added to the morphed results. brightness=100 results in a high
- * intensity brightness effect added to the morphed results.
- *
- * bool allow-bad-morphs: RANGE: [true,false], if the input images does not contain
- * an entire face, the dlib library used to identify facial landmarks will falsely
- * report a facial landmark outside the image boundaries, an effect of this is
- * un-warped areas in the resulting morph, the suggested value of this parameter
- * is hence false, as the results will be significantly better.
+ * @param parser the processed command line parser
+ * @return the process exit code
+ */
+int CommandLineMorphing::watch(QCommandLineParser &parser)
+{
+    MorphWatcher watcher;
+    QObject::connect(&watcher, &MorphWatcher::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+    if(parser.isSet("settings") && !watcher.configure(parser.value("settings"))) return 1;
+    watcher.setResume(parser.isSet("resume"));
+    watcher.setCacheDirectory(parser.value("cache"));
+    watcher.setMemoryBudget(parser.value("memory-budget").toLongLong() * 1024 * 1024);
+    if(parser.isSet("encoder-threads")) watcher.setEncoderThreads(parser.value("encoder-threads").toInt());
+    watcher.setArchiveOutput(parser.value("archive").toLongLong() * 1024 * 1024);
+    if(!watcher.start(parser.value("input-directory"), parser.value("output-directory"))) return 1;
+    return QCoreApplication::exec();
+}
+
+/**
+ * @brief CommandLineMorphing::stream
  *
- * unsigned int format: suggested RANGE: [0,1], the parameter specifies the format
- * of the output images. format=0 results in jpeg formatted outputs. format=1
- * results in png formatted outputs.
+ * Morphs the pairs streamed on stdin until it is closed, see MorphStream. The
+ * messages are written to stderr, stdout only carries the results.
  *
- * @return true if the *.json settings file were correctly parsed.
+ * @param parser the processed command line parser
+ * @return the process exit code
  */
-bool CommandLineMorphing::apply_settings()
+int CommandLineMorphing::stream(QCommandLineParser &parser)
 {
-    qDebug() << "Applying the provided json settings\n";
-    QFile json_file(m_json_path);
-    json_file.open(QIODevice::ReadOnly | QIODevice::Text);
-    QJsonDocument document = QJsonDocument::fromJson(json_file.readAll());
-    QJsonObject object = document.object();
-    json_file.close();
-
-    m_image_width = object["resolution"].toArray()[0].toInt();
-    m_image_height = object["resolution"].toArray()[1].toInt();
-    m_alpha = (float)object["alpha"].toDouble();
-    m_h_filter = object["h-filter"].toInt();
-    m_g_filter = object["g-filter"].toInt();
-    m_m_filter = object["m-filter"].toInt();
-    m_b_filter = object["b-filter"].toInt();
-    m_transform = object["transform"].toInt();
-    m_sharpness = object["sharpness"].toInt();
-    m_contrast = object["contrast"].toInt();
-    m_brightness = object["brightness"].toInt();
-    m_allow_bad_morphs = object["allow-bad-morphs"].toBool();
-    m_format = object["format"].toInt();
-
-    qDebug() << "image_width:" << m_image_width;
-    qDebug() << "image_height:" << m_image_height;
-    qDebug() << "alpha:" << m_alpha;
-    qDebug() << "homogenous filter:" << m_h_filter;
-    qDebug() << "gaussian filter:" << m_g_filter;
-    qDebug() << "median filter:" << m_m_filter;
-    qDebug() << "bilateral filter:" << m_b_filter;
-    qDebug() << "transform:" << (m_transform == 0 ? "normal" : "grayscale");
-    qDebug() << "sharpness:" << m_sharpness;
-    qDebug() << "contrast:" << m_contrast;
-    qDebug() << "brightness:" << m_brightness;
-    qDebug() << "allow bad morphs:" << m_allow_bad_morphs;
-    qDebug() << "format:" << (m_format == 0 ? "jpg" : "png") << "\n";
-
-    return true;
+    MorphEngine engine;
+    QObject::connect(&engine, &MorphEngine::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+    MorphStream stream(&engine);
+    QObject::connect(&stream, &MorphStream::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+    if(parser.isSet("encoder-threads")) stream.setEncoderThreads(parser.value("encoder-threads").toInt());
+    if(parser.isSet("settings") && !engine.configure(parser.value("settings"))) return 1;
+
+    QFile input;
+    QFile output;
+    if(!input.open(0, QIODevice::ReadOnly | QIODevice::Unbuffered)
+            || !output.open(1, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        qWarning() << "Unable to open stdin and stdout";
+        return 1;
+    }
+    if(stream.run(&input, &output)) return 0;
+    qWarning().noquote() << engine.errorString();
+    return 1;
 }
 
 /**
- * @brief CommandLineMorphing::load_images
+ * @brief CommandLineMorphing::selfTest
  *
- * A procedure to load images from the m_input_directory,
- * set in the ctor of the CommandLineMorphing class.
+ * Verifies every vectorized variant of the pixel kernels supported by the processor against
+ * the scalar reference, see fmg::PixelKernels::selfTest(), and reports the variant every
+ * job of this processor runs.
  *
- * Initially a filter is added to the input directory to search for
- * *.jpg, *.jpeg or *.png files. If the resulting file count is less than or
- * equal to one, no images will be morphed.
+ * @return the process exit code, 1 if a variant disagrees with the reference
+ */
+int CommandLineMorphing::selfTest()
+{
+    const char *names[] = {"scalar", "SSE4.2", "AVX2", "AVX-512"};
+    fmg::PixelKernels::Isa supported = fmg::PixelKernels::detectIsa();
+    bool ok = true;
+    for(int level = fmg::PixelKernels::SSE42; level <= supported; ++level) {
+        bool agrees = fmg::PixelKernels::selfTest((fmg::PixelKernels::Isa)level);
+        qDebug().noquote() << "PixelKernels" << names[level] << (agrees ? "agrees with" : "disagrees with")
+                           << "the scalar reference";
+        ok = ok && agrees;
+    }
+    qDebug().noquote() << "PixelKernels: the jobs of this processor run the" << names[supported] << "kernels";
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief CommandLineMorphing::coordinate
  *
- * If the *.json settings file contained a
- * "resolution": [-1,-1] value, the procedure will automatically find the
- * lowest resolution image the input directory and scale all the remaining
- * images to the found resolution, note that the procedure will not modify
- * the original files but scale copies of these.
+ * Serves the job described by the options to worker processes until it is done, requires
+ * a QCoreApplication.
  *
- * @return true if images were succesfully loaded.
+ * @param parser the processed command line parser
+ * @return the process exit code, 0 if every result was saved
  */
-bool CommandLineMorphing::load_images()
+int CommandLineMorphing::coordinate(QCommandLineParser &parser)
 {
-    QDir files(m_input_directory);
-    files.setFilter(QDir::NoDotAndDotDot | QDir::Files);
-    files.setNameFilters(QStringList() << "*.jpg" << "*.jpeg" << "*.png");
-    if(files.count() <= 0) return false;
-
-    QDirIterator it(files);
-
-    std::vector<int> widths;
-    std::vector<int> heights;
-
-    QStringList paths;
-    while(it.hasNext()) {
-        paths << it.next();
-        if(m_image_width == -1 || m_image_height == -1) {
-            QImage img(it.filePath());
-            if(img.isNull()) return false;
-            widths.push_back(img.width());
-            heights.push_back(img.height());
-        }
+    QJsonObject settings;
+    if(parser.isSet("settings") && !readSettings(parser.value("settings"), settings)) return 1;
+
+    MorphCoordinator coordinator;
+    QObject::connect(&coordinator, &MorphCoordinator::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+    QObject::connect(&coordinator, &MorphCoordinator::finished,
+                     [](bool ok){QCoreApplication::exit(ok ? 0 : 1);});
+    bool ok = coordinator.setJob(parser.value("input-directory"), parser.value("output-directory"),
+                                 settings, parser.isSet("resume"));
+    ok = ok && coordinator.listen((quint16)parser.value("coordinator").toUInt());
+    if(!ok) {
+        qWarning().noquote() << coordinator.errorString();
+        return 1;
     }
+    return QCoreApplication::exec();
+}
 
-    if(m_image_width == -1 || m_image_height == -1) {
-        m_image_width = (int)(*std::min_element(widths.begin(), widths.end()));
-        m_image_height = (int)(*std::min_element(heights.begin(), heights.end()));
+/**
+ * @brief CommandLineMorphing::work
+ *
+ * Works on the job of a coordinator until it is done, requires a QCoreApplication.
+ *
+ * @param address the host:port of the coordinator
+ * @param cache_dir the cache of decoded images of this node, empty to disable the cache
+ * @return the process exit code, 0 if the job is done
+ */
+int CommandLineMorphing::work(const QString &address, const QString &cache_dir)
+{
+    int separator = address.lastIndexOf(':');
+    if(separator <= 0) {
+        qWarning().noquote() << "Invalid coordinator, expected host:port:" << address;
+        return 1;
     }
+    MorphWorker worker;
+    QObject::connect(&worker, &MorphWorker::message,
+                     [](const QString &text){qDebug().noquote() << text;});
+    QObject::connect(&worker, &MorphWorker::finished,
+                     [](bool ok){QCoreApplication::exit(ok ? 0 : 1);});
+    worker.setCacheDirectory(cache_dir);
+    worker.connectToCoordinator(address.left(separator), (quint16)address.mid(separator + 1).toUInt());
+    return QCoreApplication::exec();
+}
 
-    fmg::Globals::img_width = m_image_width;
-    fmg::Globals::img_height = m_image_height;
-
-    for(const QString &path : paths) {
-        qDebug() << "Loading:" << path;
-        ImageContainer *image = new ImageContainer(this);
-        auto load_status = image->setImageSource(path);
-        if(!load_status) return false;
-        m_database.push_back(image);
+/**
+ * @brief CommandLineMorphing::serve
+ *
+ * Runs a MorphService until the process is terminated, requires a QCoreApplication.
+ *
+ * @param name the local socket name or path
+ * @return the process exit code
+ */
+int CommandLineMorphing::serve(const QString &name)
+{
+    MorphService service;
+    if(!service.listen(name)) {
+        qWarning().noquote() << "Unable to start the morph service:" << service.errorString();
+        return 1;
     }
-
-    return true;
+    qDebug().noquote() << "Morph service listening on:" << name;
+    return QCoreApplication::exec();
 }
 
 /**
- * @brief CommandLineMorphing::morph_images
- *
- * An auxillary method to morph the images of the input directory
- * and save the results with the specified filters of the *.json
- * settings file. Note that as of this version of the software,
- * the morph_images() procedure morphs every image with each other.
- * Hence resulting in O(N^2) runtime, N = amount of images detected
- * in the input directory. For the users convenience I suggest
- * input directories of smaller sizes to test the software.
+ * @brief CommandLineMorphing::submit
  *
- * The individual morphing procedures are explained in the routines
- * of the ImageProcessor class.
+ * Submits the job described by the options to a running MorphService. The directories are
+ * made absolute, since the service does not share the working directory of the client, and
+ * the settings file is read here and sent inline.
  *
+ * @param parser the processed command line parser
+ * @return the process exit code, 0 on success
  */
-void CommandLineMorphing::morph_images()
+int CommandLineMorphing::submit(QCommandLineParser &parser)
 {
-    for(ImageContainer *img : m_database) {
-        qDebug() << "Detecting landmarks:" << img->getImageTitle();
-        img->setLandmarks(m_image_processor.getFacialFeatures(img));
-    }
-    for(ImageContainer *one : m_database) {
-        if(one->hasBadLandmarks() && !m_allow_bad_morphs) continue;
-        for(ImageContainer *two : m_database) {
-            if(one == two) continue;
-            if(two->hasBadLandmarks() && !m_allow_bad_morphs) continue;
-            qDebug() << "Morphing:" << one->getImageTitle() << "with" << two->getImageTitle();
-            ImageContainer target;
-            m_image_processor.morphImages(one, two, &target, m_alpha);
-            QImage img = target.getSource();
-            apply_filters(img);
-            target.setImage(img);
-            QString format = m_format == 0 ? ".jpg" : ".png";
-            if(m_transform > 0) {
-                target.getGrayscaleSource().save(m_output_directory+"/"+"g_"+target.getImageTitle()+target.getId()+format);
-            } else {
-                target.getTempSource().save(m_output_directory+"/"+target.getImageTitle()+target.getId()+format);
-            }
-        }
+    QJsonObject job;
+    job["input"] = QDir(parser.value("input-directory")).absolutePath();
+    job["output"] = QDir(parser.value("output-directory")).absolutePath();
+    job["resume"] = parser.isSet("resume");
+    if(parser.isSet("cache")) job["cache"] = QDir(parser.value("cache")).absolutePath();
+    if(parser.isSet("archive")) job["archive"] = parser.value("archive").toDouble() * 1024 * 1024;
+    if(parser.isSet("settings")) {
+        QJsonObject settings;
+        if(!readSettings(parser.value("settings"), settings)) return 1;
+        job["settings"] = settings;
     }
+    return MorphService::submit(parser.value("connect"), job);
 }
 
 /**
- * @brief CommandLineMorphing::apply_filters
+ * @brief CommandLineMorphing::readSettings
  *
- * An auxillary class method to apply the post-processing routines
- * specified in the *.json settings file provided. If a *.json settings
- * file is not provided, the procedure uses standard values namely:
+ * Reads a json settings file which is sent to another process rather than applied here.
  *
- * m_image_width(-1)            // automatic resolution detection
- * m_image_height(-1)           // automatic resolution detection
- * m_alpha(0.5)                 // 50/50 alpha blending
- * m_h_filter(0)                // no homogenous filtering
- * m_g_filter(0)                // no gaussian filtering
- * m_m_filter(0)                // no median filtering
- * m_b_filter(0)                // no bilateral filtering
- * m_transform(0)               // no post-processing transformation
- * m_sharpness(0)               // no sharpness increase
- * m_contrast(0)                // no contrast increase
- * m_brightness(0)              // no brightness increase
- * m_allow_bad_morphs(false)    // do not allow bad morphs
- * m_format(0)                  // .jpg
- *
- * @param img the image which the filters will be applied to.
+ * @param path the path to the *.json settings file
+ * @param settings the parsed settings
+ * @return true if the file was read and parsed
  */
-void CommandLineMorphing::apply_filters(QImage &img)
+bool CommandLineMorphing::readSettings(const QString &path, QJsonObject &settings)
 {
-    if(img.isNull()) return;
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::BRIGHTNESS,
-                                  m_brightness);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::CONTRAST,
-                                  m_contrast);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::SHARPNESS,
-                                  m_sharpness);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::BILATERAL,
-                                  m_b_filter);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::MEDIAN,
-                                  m_m_filter);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::GAUSSIAN,
-                                  m_g_filter);
-    m_image_processor.applyFilter(img,
-                                  ImageProcessor::Filter::HOMOGENEOUS,
-                                  m_h_filter);
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning().noquote() << "Unable to open settings file:" << path;
+        return false;
+    }
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if(!document.isObject()) {
+        qWarning().noquote() << "Invalid json settings file:" << path;
+        return false;
+    }
+    settings = document.object();
+    return true;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
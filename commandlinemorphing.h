@@ -1,45 +1,25 @@
 #pragma once
-#include <QWidget>
 
-#include "imageprocessor.h"
-
-#include <vector>
-#include <QString>
-
-class ImageContainer;
-class CommandLineMorphing : public QWidget {
-    Q_OBJECT
+class QCommandLineParser;
+class QJsonObject;
+class QString;
+/**
+ * @brief The CommandLineMorphing class
+ *
+ * The command line front-end of the MorphEngine, shared by the fmg-qt and fmg-cli executables.
+ */
+class CommandLineMorphing {
 public:
-    explicit CommandLineMorphing(const QString &input_dir,
-                                 const QString &output_dir,
-                                 const QString &json_path = "");
-    ~CommandLineMorphing() = default;
-
-private:
-    bool apply_settings();
-    bool load_images();
-    void morph_images();
-    void apply_filters(QImage &img);
-
-private:
-    QString m_input_directory;
-    QString m_output_directory;
-    QString m_json_path;
+    static void addOptions(QCommandLineParser &parser);
+    static int run(QCommandLineParser &parser);
 
 private:
-    int m_image_width;
-    int m_image_height;
-    float m_alpha;
-    int m_h_filter;
-    int m_g_filter;
-    int m_m_filter;
-    int m_b_filter;
-    int m_transform;
-    int m_sharpness;
-    int m_contrast;
-    int m_brightness;
-    bool m_allow_bad_morphs;
-    int m_format;
-    ImageProcessor m_image_processor;
-    std::vector<ImageContainer*> m_database;
+    static int watch(QCommandLineParser &parser);
+    static int stream(QCommandLineParser &parser);
+    static int coordinate(QCommandLineParser &parser);
+    static int work(const QString &address, const QString &cache_dir);
+    static int serve(const QString &name);
+    static int submit(QCommandLineParser &parser);
+    static int selfTest();
+    static bool readSettings(const QString &path, QJsonObject &settings);
 };
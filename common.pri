@@ -0,0 +1,24 @@
+# Settings shared by the fmg-core, fmg-qt and fmg-cli projects. The projects share a
+# directory, hence every project keeps its own Makefile and intermediate directories.
+
+CONFIG += c++14
+CONFIG -= debug_and_release
+
+MAKEFILE = Makefile.$$TARGET
+OBJECTS_DIR = $$OUT_PWD/.build/$$TARGET/obj
+MOC_DIR = $$OUT_PWD/.build/$$TARGET/moc
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which has been marked as deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# You can also make your code fail to compile if you use deprecated APIs.
+# In order to do so, uncomment the following line.
+# You can also select to disable deprecated APIs only up to a certain version of Qt.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += $$PWD/OpenBLAS/include
+INCLUDEPATH += $$PWD/dlib_build/include
+INCLUDEPATH += $$PWD/opencv_build/include
@@ -1,7 +1,7 @@
 #include "databasepreview.h"
 
 #include "console.h"
-#include "globals.h"
+#include "imageprobe.h"
 
 #include <algorithm>
 
@@ -121,7 +121,7 @@ bool DatabasePreview::loadDatabase(const QStringList &image_file_paths)
         Console::appendToConsole("Adding and scaling: " + path);
         ImageContainer *image = new ImageContainer(this);
         image->setFixedSize(width() - width() / 4.6, height() / 3);
-        if(!image->setImageSource(path)) return false;
+        if(!image->setImageSource(path, m_context)) return false;
         connect(image, SIGNAL(doubleClickDetected(ImageContainer*)),
                 this, SIGNAL(imageDoubleClicked(ImageContainer*)));
         connect(image, SIGNAL(mousePressDetected(ImageContainer*, QMouseEvent*)),
@@ -134,26 +134,20 @@ bool DatabasePreview::loadDatabase(const QStringList &image_file_paths)
 /**
  * @brief DatabasePreview::scanImageResolutions
  *
- * An auxially routine to scan images for their resolution and set the global
- * fmg::Globals::img_width and fmg::Globals::img_height. These global variables
- * are used throughout the application when determining the resolution of the
- * generated outputs, as well as the scaling of the inputs.
+ * An auxially routine to scan images for their resolution and suggest the lowest one
+ * as the fmg::MorphContext of the database. Only the image headers are read, the images
+ * are decoded once, when they are added. The context determines the scaling of the
+ * inputs, as well as the resolution of the generated outputs.
  *
  * @param image_file_paths
  */
 void DatabasePreview::scanImageResolutions(const QStringList &image_file_paths)
 {
-    std::vector<int> widths;
-    std::vector<int> heights;
-    for(const QString & path : image_file_paths) {
-        QImage img(path);
-        widths.push_back(img.width());
-        heights.push_back(img.height());
-    }
-    fmg::Globals::img_width = (int)(*std::min_element(widths.begin(), widths.end()));
-    fmg::Globals::img_height = (int)(*std::min_element(heights.begin(), heights.end()));
-    Console::appendToConsole("Minimum resolution: " + QString::number(fmg::Globals::img_width)
-                             + "x" + QString::number(fmg::Globals::img_height) + " suggested to user.");
+    QSize minimum = fmg::ImageProbe::minimumSize(image_file_paths);
+    m_context.img_width = minimum.width();
+    m_context.img_height = minimum.height();
+    Console::appendToConsole("Minimum resolution: " + QString::number(m_context.img_width)
+                             + "x" + QString::number(m_context.img_height) + " suggested to user.");
 }
 
 /**
@@ -179,9 +173,9 @@ bool DatabasePreview::imageResolutionDialog()
     QLabel d_img_w_lab("Width: ");
     QLabel d_img_h_lab("Height: ");
     QLineEdit d_w_e;
-    d_w_e.setText(QString::number(fmg::Globals::img_width));
+    d_w_e.setText(QString::number(m_context.img_width));
     QLineEdit d_h_e;
-    d_h_e.setText(QString::number(fmg::Globals::img_height));
+    d_h_e.setText(QString::number(m_context.img_height));
     QPushButton d_accept("Ok");
     QPushButton d_cancel("Cancel");
     diag_layout.addWidget(&d_title);
@@ -194,13 +188,13 @@ bool DatabasePreview::imageResolutionDialog()
     diag_group_three.addWidget(&d_accept);
     diag_group_three.addWidget(&d_cancel);
     diag_layout.addLayout(&diag_group_three);
-    QObject::connect(&d_accept, &QPushButton::released, [&result, &d_w_e, &d_h_e, &selectImageResolutionDialog](){
+    QObject::connect(&d_accept, &QPushButton::released, [this, &result, &d_w_e, &d_h_e, &selectImageResolutionDialog](){
         int width = d_w_e.text().toInt();
         int height = d_h_e.text().toInt();
         if(width > 0 && height > 0) {
             result = true;
-            fmg::Globals::img_width = width;
-            fmg::Globals::img_height = height;
+            m_context.img_width = width;
+            m_context.img_height = height;
             selectImageResolutionDialog.close();
         }
     });
@@ -1,6 +1,8 @@
 #pragma once
 #include "scrollableqgroupbox.h"
 
+#include "morphcontext.h"
+
 class DatabasePreview : public ScrollableQGroupBox
 {
     Q_OBJECT
@@ -22,4 +24,7 @@ private:
     bool loadDatabase(const QStringList &image_file_paths);
     void scanImageResolutions(const QStringList &image_file_paths);
     bool imageResolutionDialog();
+
+private:
+    fmg::MorphContext m_context;
 };
@@ -0,0 +1,20 @@
+# Links fmg-core and its third party dependencies into an executable, the static library
+# has to precede the libraries it depends on.
+
+LIBS += -L$$OUT_PWD/lib \
+        -lfmg-core
+PRE_TARGETDEPS += $$OUT_PWD/lib/libfmg-core.a
+
+LIBS += -L$$PWD/OpenBLAS/lib \
+        -lopenblas
+
+LIBS += -L$$PWD/dlib_build/lib \
+        -ldlib
+
+LIBS += -L$$PWD/opencv_build/x64/mingw/staticlib \
+        -lopencv_imgproc341 \
+        -lopencv_core341 \
+        -lzlib
+
+# shm_open of fmg::FrameRing, part of libc since glibc 2.34
+linux: LIBS += -lrt
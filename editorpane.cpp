@@ -13,6 +13,7 @@
 #include <QPushButton>
 #include <QButtonGroup>
 #include <QRadioButton>
+#include <QComboBox>
 #include <QSlider>
 #include <QFile>
 
@@ -46,7 +47,12 @@ EditorPane::EditorPane(ImageContainer *ref_one,
     m_r_grayscale(new QRadioButton("Grayscale", this)),
     m_r_fourier(new QRadioButton("Fourier", this)),
     m_b_add_to_results(new QPushButton("Add to results", this)),
-    m_b_save_as(new QPushButton("Save as", this))
+    m_b_save_as(new QPushButton("Save as", this)),
+    m_spectral_container(new QGroupBox("Spectral Filter", this)),
+    m_spectral_layout(new QVBoxLayout),
+    m_spectral_mask(new QComboBox(this)),
+    m_filtered_source_key(0),
+    m_spectral_source_key(0)
 {
     setup();
     setupConnections();
@@ -90,6 +96,16 @@ void EditorPane::setup()
     m_col_two_layout->addWidget(m_radio_buttons_container);
     m_col_two_layout->addWidget(m_slider_group_two);
 
+    m_spectral_mask->addItems(QStringList() << "None" << "Low-pass" << "High-pass" << "Band-pass" << "Notch");
+    m_spectral_mask->setEnabled(false);
+    m_spectral_sliders = new LabelledSliderGroup(QStringList() << "Cutoff" << "Band Width", Qt::Horizontal, this);
+    m_spectral_sliders->getSlider(CUTOFF)->setValue(50);
+    m_spectral_sliders->getSlider(BAND_WIDTH)->setValue(10);
+    m_spectral_layout->addWidget(m_spectral_mask);
+    m_spectral_layout->addWidget(m_spectral_sliders);
+    m_spectral_container->setLayout(m_spectral_layout);
+    m_col_two_layout->addWidget(m_spectral_container);
+
     m_col_two_layout->addWidget(m_b_add_to_results);
     m_col_two_layout->addWidget(m_b_save_as);
 
@@ -130,6 +146,15 @@ void EditorPane::setupConnections()
     connect(m_slider_group_two->getSlider(2), SIGNAL(sliderMoved(int)),
             this, SLOT(smoothFilters()));
 
+    connect(m_spectral_mask, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(smoothFilters()));
+
+    connect(m_spectral_sliders->getSlider(CUTOFF), SIGNAL(sliderMoved(int)),
+            this, SLOT(smoothFilters()));
+
+    connect(m_spectral_sliders->getSlider(BAND_WIDTH), SIGNAL(sliderMoved(int)),
+            this, SLOT(smoothFilters()));
+
     connect(m_r_normal, SIGNAL(toggled(bool)),
             this, SLOT(m_r_normal_selected()));
 
@@ -144,6 +169,8 @@ void EditorPane::setupConnections()
 
     connect(m_b_save_as, SIGNAL(released()),
             this, SLOT(m_b_save_as_pressed()));
+
+    connect(m_image_processor, &ImageProcessor::message, &Console::appendToConsole);
 }
 
 /**
@@ -162,7 +189,12 @@ bool EditorPane::detectLandmarks(ImageContainer *img)
 {
     if(img->hasLandmarks()) return false;
     if(!img->hasImage()) return false;
-    img->setLandmarks(m_image_processor->getFacialFeatures(img));
+    std::vector<QPoint> landmarks = m_image_processor->getFacialFeatures(img);
+    if(landmarks.empty()) {
+        Console::appendToConsole("No face detected: " + img->getImageTitle());
+        return false;
+    }
+    img->setLandmarks(landmarks);
     return true;
 }
 
@@ -195,6 +227,8 @@ void EditorPane::toggleFilters(bool on)
 {
     m_slider_group_one->toggleSliders(HOMOGENEOUS, BILATERAL, on);
     m_slider_group_two->toggleSliders(0, 2, on);
+    m_spectral_mask->setEnabled(on);
+    m_spectral_sliders->toggleSliders(CUTOFF, BAND_WIDTH, on);
     m_b_add_to_results->setEnabled(on);
     m_b_save_as->setEnabled(on);
     m_r_normal->setEnabled(on);
@@ -213,6 +247,9 @@ void EditorPane::resetSliders()
 {
     m_slider_group_one->resetSliders(HOMOGENEOUS, BILATERAL);
     m_slider_group_two->resetSliders(0, 2);
+    m_spectral_mask->setCurrentIndex(ImageProcessor::NO_MASK);
+    m_spectral_sliders->getSlider(CUTOFF)->setValue(50);
+    m_spectral_sliders->getSlider(BAND_WIDTH)->setValue(10);
 }
 
 
@@ -227,6 +264,8 @@ void EditorPane::resetAll()
 {
     m_slider_group_one->toggleSliders(ALPHA, BILATERAL, false);
     m_slider_group_two->toggleSliders(0, 2, false);
+    m_spectral_mask->setEnabled(false);
+    m_spectral_sliders->toggleSliders(CUTOFF, BAND_WIDTH, false);
     resetSliders();
     m_r_normal->setChecked(true);
     m_r_normal->setEnabled(false);
@@ -248,7 +287,8 @@ void EditorPane::m_morph_target_b_pressed()
     m_image_processor->morphImages(m_reference_one,
                                    m_reference_two,
                                    m_target,
-                                   m_slider_group_one->getSliderValue(ALPHA));
+                                   m_slider_group_one->getSliderValue(ALPHA),
+                                   m_reference_one->getContext());
     m_r_normal->setChecked(true);
     toggleFilters(true);
 }
@@ -304,7 +344,8 @@ void EditorPane::smoothMorph()
     m_image_processor->morphImages(m_reference_one,
                                    m_reference_two,
                                    m_target,
-                                   m_slider_group_one->getSliderValue(ALPHA));
+                                   m_slider_group_one->getSliderValue(ALPHA),
+                                   m_reference_one->getContext());
     smoothFilters();
 }
 
@@ -319,8 +360,7 @@ void EditorPane::smoothMorph()
  */
 void EditorPane::smoothFilters()
 {
-    QImage img = m_target->getSource();
-    applyFilters(img);
+    QImage img = filteredTarget();
     m_target->setImage(img);
     if(m_r_grayscale->isChecked()) {
         m_target->displayGrayscale();
@@ -331,6 +371,50 @@ void EditorPane::smoothFilters()
     }
 }
 
+/**
+ * @brief EditorPane::filteredTarget
+ *
+ * A private convenience method returning the morphed result with the slider filters and the
+ * selected spectral filter applied. The results are cached by the version of their input and
+ * the slider values, hence switching between the transformations of an unchanged morph reuses
+ * the filtered image, and with it the cached spectrum of the ImageProcessor. Adjusting the
+ * spectral filter alone only repeats the inverse transforms of the cached spectra.
+ *
+ * @return the filtered morph result
+ */
+QImage EditorPane::filteredTarget()
+{
+    QImage source = m_target->getSource();
+    std::vector<int> settings;
+    for(int slider = HOMOGENEOUS; slider <= BILATERAL; ++slider) {
+        settings.push_back(m_slider_group_one->getSlider(slider)->value());
+    }
+    for(int slider = 0; slider <= 2; ++slider) {
+        settings.push_back(m_slider_group_two->getSlider(slider)->value());
+    }
+    if(m_filtered.isNull() || source.cacheKey() != m_filtered_source_key || settings != m_filtered_settings) {
+        m_filtered = source;
+        applyFilters(m_filtered);
+        m_filtered_source_key = source.cacheKey();
+        m_filtered_settings = settings;
+    }
+
+    auto mask = (ImageProcessor::SpectralMask)m_spectral_mask->currentIndex();
+    if(mask == ImageProcessor::NO_MASK) return m_filtered;
+    std::vector<int> spectral_settings = {mask,
+                                          m_spectral_sliders->getSlider(CUTOFF)->value(),
+                                          m_spectral_sliders->getSlider(BAND_WIDTH)->value()};
+    if(m_spectral.isNull() || m_filtered.cacheKey() != m_spectral_source_key || spectral_settings != m_spectral_settings) {
+        m_spectral = m_filtered;
+        m_image_processor->spectralFilter(m_spectral, mask,
+                                          m_spectral_sliders->getSliderValue(CUTOFF),
+                                          m_spectral_sliders->getSliderValue(BAND_WIDTH));
+        m_spectral_source_key = m_filtered.cacheKey();
+        m_spectral_settings = spectral_settings;
+    }
+    return m_spectral;
+}
+
 /**
  * @brief EditorPane::m_r_normal_selected
  *
@@ -374,9 +458,6 @@ void EditorPane::m_r_fourier_selected()
     if(m_r_fourier->isChecked()) {
         m_target->isDisplayingGrayscale(false);
         smoothFilters();
-        QImage img = m_target->getTempSource();
-        m_image_processor->fourierTransform(img);
-        m_target->setImage(img);
     }
 }
 
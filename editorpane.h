@@ -1,6 +1,9 @@
 #pragma once
 #include <QGroupBox>
 
+#include <vector>
+#include <QImage>
+
 class ImageContainer;
 class ImageProcessor;
 class LabelledSliderGroup;
@@ -9,6 +12,7 @@ class QVBoxLayout;
 class QPushButton;
 class QButtonGroup;
 class QRadioButton;
+class QComboBox;
 class EditorPane : public QGroupBox
 {
     Q_OBJECT
@@ -23,9 +27,14 @@ public:
         ALPHA, HOMOGENEOUS, GAUSSIAN, MEDIAN, BILATERAL
     };
 
+    enum SPECTRAL_SLIDERS {
+        CUTOFF, BAND_WIDTH
+    };
+
 private:
     void setup();
     void setupConnections();
+    QImage filteredTarget();
 
 signals:
     void addToResultsInvoked(ImageContainer*);
@@ -73,4 +82,17 @@ private:
 
     LabelledSliderGroup *m_slider_group_one;
     LabelledSliderGroup *m_slider_group_two;
+
+    QGroupBox *m_spectral_container;
+    QVBoxLayout *m_spectral_layout;
+    QComboBox *m_spectral_mask;
+    LabelledSliderGroup *m_spectral_sliders;
+
+    QImage m_filtered;
+    qint64 m_filtered_source_key;
+    std::vector<int> m_filtered_settings;
+
+    QImage m_spectral;
+    qint64 m_spectral_source_key;
+    std::vector<int> m_spectral_settings;
 };
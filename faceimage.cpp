@@ -0,0 +1,392 @@
+#include "faceimage.h"
+
+#include "imagebridge.h"
+#include "imagesource.h"
+
+#include <QRegExp>
+#include <QScopedPointer>
+#include <QRect>
+
+#include <QPainter>
+#include <QPen>
+
+/**
+ * @brief FaceImage::FaceImage
+ *
+ * The FaceImage ctor, creates a random UUID used to uniquely identify the image contained
+ * in this class. The UUID is regenerated when the image is changed in any form or way.
+ */
+FaceImage::FaceImage() :
+    m_contains_image(false),
+    m_id(QUuid::createUuid()) {}
+
+/**
+ * @brief FaceImage::reset
+ *
+ * Clears the images, landmarks and metadata of this FaceImage.
+ *
+ */
+void FaceImage::reset()
+{
+    m_source = QImage();
+    m_temp_source = QImage();
+    m_grayscale_source = QImage();
+    m_landmark_image = QImage();
+    m_img_path = 0;
+    m_img_title = "";
+    m_contains_image = false;
+    m_landmarks.clear();
+    m_id = 0;
+    m_context = fmg::MorphContext();
+}
+
+/**
+ * @brief FaceImage::setImageSource
+ *
+ * Given a valid image file path, this method loads the image. The image is decoded at a
+ * reduced size if possible and scaled to the resolution of the context, see decodeScaled(),
+ * and normalized to the canonical pixel format once, see fmg::ImageBridge.
+ *
+ * @param path a valid image file path
+ * @param context the job the image is loaded for
+ * @return true if loading was successful
+ */
+bool FaceImage::setImageSource(const QString &path, const fmg::MorphContext &context)
+{
+    return setImageSource(path, decodeScaled(path, QSize(context.img_width, context.img_height)), context);
+}
+
+/**
+ * @brief FaceImage::setImageSource
+ *
+ * Sets the source image of an image file which has been decoded and scaled already, e.g.
+ * by fmg::PixelCache. The decoded pixels are shared if they are in the canonical format.
+ *
+ * @param path the path of the image file
+ * @param decoded the decoded image, scaled to the resolution of the context
+ * @param context the job the image is loaded for
+ * @return true if the decoded image is notNull()
+ */
+bool FaceImage::setImageSource(const QString &path, const QImage &decoded, const fmg::MorphContext &context)
+{
+    if(decoded.isNull()) return false;
+    m_context = context;
+    m_source = fmg::ImageBridge::canonical(decoded);
+    m_temp_source = m_source;
+    m_grayscale_source = QImage(); // derived on first use, see getGrayscaleSource()
+    setImagePath(path);
+    m_contains_image = true;
+    sourceChanged();
+    return true;
+}
+
+/**
+ * @brief FaceImage::decodeScaled
+ *
+ * Decodes an image file and scales it to the target size. Oversized JPEG files are decoded
+ * at 1/2, 1/4 or 1/8 of their size in the DCT domain, the largest reduction which is not
+ * smaller than the target, hence most of the decoding work and memory is skipped for
+ * camera images. The exact target size is reached by a smooth resample, see
+ * fmg::ImageSource::decodeScaled().
+ *
+ * @param path a valid image file path or archive member, see fmg::ImageSource
+ * @param size the target size
+ * @return the scaled image, null if the file could not be decoded
+ */
+QImage FaceImage::decodeScaled(const QString &path, const QSize &size)
+{
+    QScopedPointer<QIODevice> device(fmg::ImageSource::open(path));
+    return fmg::ImageSource::decodeScaled(device.data(), size);
+}
+
+/**
+ * @brief FaceImage::setImageSource
+ *
+ * Given a notNull() QImage source, this method sets the source image. The source is shared
+ * rather than copied, QImage detaches if either copy is modified later on. A grayscale
+ * source, e.g. a grayscale morph, is kept in QImage::Format_Grayscale8.
+ *
+ * @param source a notNull() QImage source
+ */
+void FaceImage::setImageSource(const QImage &source)
+{
+    m_source = fmg::ImageBridge::processable(source);
+    m_context.img_width = m_source.width();
+    m_context.img_height = m_source.height();
+    m_temp_source = m_source;
+    m_grayscale_source = QImage(); // derived on first use, see getGrayscaleSource()
+    m_contains_image = true;
+    sourceChanged();
+}
+
+/**
+ * @brief FaceImage::setImage
+ *
+ * A public class method to update the processed image of this FaceImage. The grayscale
+ * version of the image is derived when it is first requested.
+ *
+ * @param image the processed QImage
+ */
+void FaceImage::setImage(const QImage &image)
+{
+    m_temp_source = image;
+    m_grayscale_source = QImage(); // derived on first use, see getGrayscaleSource()
+    m_contains_image = true;
+    imageChanged();
+}
+
+/**
+ * @brief FaceImage::setImagePath
+ *
+ * Sets the path of the image file and derives the title from it, the image is not loaded.
+ *
+ * @param path the image file path
+ */
+void FaceImage::setImagePath(const QString &path)
+{
+    m_img_path = path;
+    m_img_title = m_img_path.toString();
+    m_img_title.replace(QRegExp("(.jpg)|(.png)|(.jpeg)"),"");
+    m_img_title.replace(QRegExp(".*/"),"");
+}
+
+/**
+ * @brief FaceImage::releaseImages
+ *
+ * Releases the pixels of the images, the path, title, landmarks and context are kept such
+ * that the source can be loaded again, see fmg::ImageStore.
+ *
+ */
+void FaceImage::releaseImages()
+{
+    m_source = QImage();
+    m_temp_source = QImage();
+    m_grayscale_source = QImage();
+    m_landmark_image = QImage();
+    m_contains_image = false;
+}
+
+/**
+ * @brief FaceImage::releaseDerivedImages
+ *
+ * Releases the grayscale image and the landmark overlay, they are derived again from the
+ * source when they are requested, see fmg::ImageStore.
+ *
+ */
+void FaceImage::releaseDerivedImages()
+{
+    m_grayscale_source = QImage();
+    m_landmark_image = QImage();
+}
+
+/**
+ * @brief FaceImage::imageBytes
+ * @return the bytes of the pixels held by the images, shared pixels are counted once
+ */
+qint64 FaceImage::imageBytes() const
+{
+    auto bytes = [](const QImage &image) { return (qint64)image.bytesPerLine() * image.height(); };
+    qint64 total = bytes(m_source) + bytes(m_grayscale_source) + bytes(m_landmark_image);
+    if(m_temp_source.constBits() != m_source.constBits()) total += bytes(m_temp_source);
+    return total;
+}
+
+/**
+ * @brief FaceImage::setLandmarks
+ *
+ * Sets the detected image landmarks and adds 8 extra landmarks to the corners/midpoints of
+ * the scaled source image if desired. The landmark overlay is rendered on demand, see
+ * getLandmarkImage(). No extra landmarks are added if no face was detected.
+ *
+ * @param landmarks the set of detected facial features.
+ * @param extra_landmarks true if 8 additional landmarks is wanted.
+ */
+void FaceImage::setLandmarks(const std::vector<QPoint> &landmarks, bool extra_landmarks)
+{
+    m_landmarks = landmarks;
+    if(extra_landmarks && !landmarks.empty()) {
+        m_landmarks.push_back(QPoint(0, 0)); // top-left
+        m_landmarks.push_back(QPoint(m_source.width() - 1, 0)); // top-right
+        m_landmarks.push_back(QPoint(0, m_source.height() - 1)); // bot-left
+        m_landmarks.push_back(QPoint(m_source.width() - 1, m_source.height() - 1)); // bot-right
+
+        m_landmarks.push_back(QPoint(0, m_source.height() / 2)); // mid-left
+        m_landmarks.push_back(QPoint(m_source.width() / 2, 0)); // mid-top
+        m_landmarks.push_back(QPoint(m_source.width() - 1, m_source.height() / 2)); // mid-right
+        m_landmarks.push_back(QPoint(m_source.width() / 2, m_source.height() - 1)); // mid-bot
+    }
+    m_landmark_image = QImage();
+    landmarksChanged();
+}
+
+/**
+ * @brief FaceImage::hasBadLandmarks
+ *
+ * A public method to determine whether the contained image contains artificial landmarks,
+ * i.e. landmarks which are not within the boundaries of the image.
+ *
+ * @param context the job defining the image boundaries
+ * @return
+ */
+bool FaceImage::hasBadLandmarks(const fmg::MorphContext &context)
+{
+    if(m_landmarks.empty()) return true; // no landmarks to iterate
+    QRect test(0, 0, context.img_width, context.img_height);
+    for(const auto &point : m_landmarks) {
+        if(!test.contains(point)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief FaceImage::generateLandmarkImage
+ *
+ * A convenience private method to generate a landmark overlay for the source image.
+ * Drawing text requires a QGuiApplication, hence the overlay is only generated when
+ * requested by a view.
+ *
+ */
+void FaceImage::generateLandmarkImage()
+{
+    QImage res(m_source.size(), QImage::Format_ARGB32);
+    QPainter painter(&res);
+    QPen pen;
+    pen.setCapStyle(Qt::RoundCap);
+
+    painter.setPen(pen);
+    painter.drawImage(QRect(0, 0, res.width(), res.height()), m_source, QRect(0, 0, res.width(), res.height()));
+    int i = 0;
+    for(const QPoint & landmark : m_landmarks) {
+        pen.setColor(Qt::blue);
+        pen.setWidth(3);
+        painter.setPen(pen);
+        painter.drawPoint(landmark);
+        pen.setColor(Qt::red);
+        painter.setPen(pen);
+        painter.drawText(landmark, QString::number(++i));
+    }
+    m_landmark_image = res;
+}
+
+/**
+ * @brief FaceImage::getContext
+ * @return the context the source image was scaled for
+ */
+fmg::MorphContext FaceImage::getContext()
+{
+    return m_context;
+}
+
+/**
+ * @brief FaceImage::getSource
+ * @return m_source
+ */
+QImage FaceImage::getSource()
+{
+    return m_source;
+}
+
+/**
+ * @brief FaceImage::getTempSource
+ * @return m_temp_source
+ */
+QImage FaceImage::getTempSource()
+{
+    return m_temp_source;
+}
+
+/**
+ * @brief FaceImage::getGrayscaleSource
+ * @return m_grayscale_source, derived from the processed image on first use
+ */
+QImage FaceImage::getGrayscaleSource()
+{
+    if(m_grayscale_source.isNull() && !m_temp_source.isNull())
+        m_grayscale_source = fmg::ImageBridge::grayscale(m_temp_source);
+    return m_grayscale_source;
+}
+
+/**
+ * @brief FaceImage::getLandmarkImage
+ * @return m_landmark_image, generated on first use after the landmarks changed
+ */
+QImage FaceImage::getLandmarkImage()
+{
+    if(m_landmark_image.isNull() && !m_landmarks.empty() && !m_source.isNull())
+        generateLandmarkImage();
+    return m_landmark_image;
+}
+
+/**
+ * @brief FaceImage::getImagePath
+ * @return m_img_path
+ */
+QUrl FaceImage::getImagePath()
+{
+   return m_img_path;
+}
+
+/**
+ * @brief FaceImage::getImageTitle
+ * @return m_img_title
+ */
+QString FaceImage::getImageTitle()
+{
+    return m_img_title;
+}
+
+/**
+ * @brief FaceImage::setImageTitle
+ * @param title
+ */
+void FaceImage::setImageTitle(const QString &title)
+{
+    m_img_title = title;
+}
+
+/**
+ * @brief FaceImage::hasImage
+ * @return m_contains_image
+ */
+bool FaceImage::hasImage()
+{
+   return m_contains_image;
+}
+
+/**
+ * @brief FaceImage::getLandmarks
+ * @return m_landmarks
+ */
+std::vector<QPoint> FaceImage::getLandmarks()
+{
+    return m_landmarks;
+}
+
+/**
+ * @brief FaceImage::hasLandmarks
+ * @return !m_landmarks.empty()
+ */
+bool FaceImage::hasLandmarks()
+{
+    return !m_landmarks.empty();
+}
+
+/**
+ * @brief FaceImage::updateId
+ *
+ * A public method to update the UUID of this FaceImage
+ *
+ */
+void FaceImage::updateId()
+{
+    m_id = QUuid::createUuid();
+}
+
+/**
+ * @brief FaceImage::getId
+ * @return m_id.toString() (QString)
+ */
+QString FaceImage::getId()
+{
+    return m_id.toString();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include <QUrl>
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QUuid>
+
+#include "morphcontext.h"
+
+/**
+ * @brief The FaceImage class
+ *
+ * The widget-free image and landmark state of a face, shared by the batch morphing path
+ * and the ImageContainer widget. The protected change hooks let a view refresh itself
+ * whenever the source, the displayed image or the landmarks are replaced. The grayscale
+ * image and the landmark overlay are derived on first use, hence a batch job which never
+ * displays them only holds the source pixels.
+ */
+class FaceImage
+{
+public:
+    FaceImage();
+    virtual ~FaceImage() = default;
+
+public:
+    void reset();
+
+    bool setImageSource(const QString &path, const fmg::MorphContext &context);
+    bool setImageSource(const QString &path, const QImage &decoded, const fmg::MorphContext &context);
+    void setImageSource(const QImage &source);
+    void setImage(const QImage &image);
+    void setImagePath(const QString &path);
+    void releaseImages();
+    void releaseDerivedImages();
+    qint64 imageBytes() const;
+
+    void setLandmarks(const std::vector<QPoint> & landmarks,
+                      bool extra_landmarks = true);
+    bool hasBadLandmarks(const fmg::MorphContext &context);
+
+public:
+    fmg::MorphContext getContext();
+    QImage getSource();
+    QImage getTempSource();
+    QImage getGrayscaleSource();
+    QImage getLandmarkImage();
+    QUrl getImagePath();
+    QString getImageTitle();
+    void setImageTitle(const QString &title);
+    bool hasImage();
+    std::vector<QPoint> getLandmarks();
+    bool hasLandmarks();
+    void updateId();
+    QString getId();
+
+protected:
+    virtual void sourceChanged() {}
+    virtual void imageChanged() {}
+    virtual void landmarksChanged() {}
+
+private:
+    static QImage decodeScaled(const QString &path, const QSize &size);
+    void generateLandmarkImage();
+
+protected:
+    QImage m_source;
+    QImage m_temp_source;
+    QImage m_grayscale_source;
+    QImage m_landmark_image;
+
+    QUrl m_img_path;
+    QString m_img_title;
+
+    bool m_contains_image;
+
+    std::vector<QPoint> m_landmarks;
+
+    QUuid m_id;
+
+    fmg::MorphContext m_context;
+};
@@ -0,0 +1,13 @@
+QT       = core gui network concurrent
+
+TARGET = fmg-cli
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+include(common.pri)
+include(dependencies.pri)
+
+SOURCES += \
+        cli.cpp
@@ -0,0 +1,54 @@
+QT       = core gui network concurrent
+
+TARGET = fmg-core
+TEMPLATE = lib
+CONFIG += staticlib
+
+include(common.pri)
+
+DESTDIR = $$OUT_PWD/lib
+
+SOURCES += \
+        faceimage.cpp \
+        framering.cpp \
+        imageprocessor.cpp \
+        morphengine.cpp \
+        morphpreforker.cpp \
+        morphstream.cpp \
+        morphbatchrunner.cpp \
+        morphservice.cpp \
+        morphwatcher.cpp \
+        morphcoordinator.cpp \
+        morphworker.cpp \
+        commandlinemorphing.cpp \
+        imagebridge.cpp \
+        imageprobe.cpp \
+        imageencoder.cpp \
+        imagesource.cpp \
+        imagestore.cpp \
+        pixelcache.cpp \
+        resultarchive.cpp \
+        pixelkernels.cpp
+
+HEADERS += \
+        faceimage.h \
+        framering.h \
+        imageprocessor.h \
+        morphengine.h \
+        morphpreforker.h \
+        morphstream.h \
+        morphbatchrunner.h \
+        morphservice.h \
+        morphwatcher.h \
+        morphcoordinator.h \
+        morphworker.h \
+        commandlinemorphing.h \
+        morphcontext.h \
+        imagebridge.h \
+        imageprobe.h \
+        imageencoder.h \
+        imagesource.h \
+        imagestore.h \
+        pixelcache.h \
+        resultarchive.h \
+        pixelkernels.h
@@ -0,0 +1,36 @@
+QT       += core gui network concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = fmg-qt
+TEMPLATE = app
+
+CONFIG += console
+
+include(common.pri)
+include(dependencies.pri)
+
+SOURCES += \
+        main.cpp \
+        mainwindow.cpp \
+        databasepreview.cpp \
+        imagecontainer.cpp \
+        imageeditor.cpp \
+        scrollableqgroupbox.cpp \
+        resultspreview.cpp \
+        editorpane.cpp \
+        labelledslidergroup.cpp \
+        console.cpp \
+        morphdatabasedialog.cpp
+
+HEADERS += \
+        mainwindow.h \
+        databasepreview.h \
+        imagecontainer.h \
+        imageeditor.h \
+        scrollableqgroupbox.h \
+        resultspreview.h \
+        editorpane.h \
+        labelledslidergroup.h \
+        console.h \
+        morphdatabasedialog.h
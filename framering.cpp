@@ -0,0 +1,449 @@
+#include "framering.h"
+
+#include "imagebridge.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define RING_MAGIC "FMGRING1"
+#define RING_ALIGNMENT 64
+#define RING_POLL_INTERVAL 1000 // us between checks of a full or empty ring
+#define RING_TIMEOUT 30000 // ms a full ring waits for the consumer to release a frame
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the ring counters must be lock-free to be shared between processes");
+
+namespace fmg {
+/**
+ * @brief aligned
+ * @param size a size in bytes
+ * @return the size rounded up to RING_ALIGNMENT
+ */
+static qint64 aligned(qint64 size)
+{
+    return (size + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+}
+
+/**
+ * @brief sharedName
+ * @param name a ring name
+ * @return the POSIX shared memory name, with the leading slash
+ */
+static QByteArray sharedName(const QString &name)
+{
+    return (name.startsWith('/') ? name : "/" + name).toLocal8Bit();
+}
+
+#ifdef Q_OS_UNIX
+/**
+ * @brief processGone
+ * @param pid the pid recorded in a RingHeader
+ * @return true if the process does not exist anymore
+ */
+static bool processGone(qint32 pid)
+{
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+/**
+ * @brief replaceable
+ *
+ * Checks whether an existing shared memory of a name may be replaced by a new ring, i.e.
+ * whether it is a ring which was closed or whose producer is gone, e.g. after a crash.
+ *
+ * @param shared the POSIX shared memory name
+ * @return true if the name is unused or holds a stale ring
+ */
+static bool replaceable(const QByteArray &shared)
+{
+    int fd = shm_open(shared.constData(), O_RDONLY, 0);
+    if(fd < 0) return errno == ENOENT;
+    struct stat info;
+    bool stale = false;
+    if(fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(RingHeader)) {
+        void *memory = mmap(nullptr, sizeof(RingHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if(memory != MAP_FAILED) {
+            const RingHeader *header = static_cast<const RingHeader*>(memory);
+            stale = std::memcmp(header->magic, RING_MAGIC, sizeof(header->magic)) == 0
+                    && (header->closed.load(std::memory_order_acquire) || processGone(header->producer.load()));
+            munmap(memory, sizeof(RingHeader));
+        }
+    }
+    ::close(fd);
+    return stale;
+}
+#endif
+
+/**
+ * @brief FrameRing::FrameRing
+ */
+FrameRing::FrameRing() :
+    m_owner(false),
+    m_memory(nullptr),
+    m_size(0),
+    m_header(nullptr),
+    m_timeout(RING_TIMEOUT)
+{
+}
+
+/**
+ * @brief FrameRing::~FrameRing
+ *
+ * Closes the ring, see close().
+ *
+ */
+FrameRing::~FrameRing()
+{
+    close();
+}
+
+/**
+ * @brief FrameRing::create
+ *
+ * Creates the ring as its producer. A ring of the same name is only replaced if it was
+ * closed or its producer is gone, a ring another producer still publishes to, or any other
+ * shared memory of the name, is not touched and fails the call.
+ *
+ * @param name the shared memory name, e.g. "fmg-morphs"
+ * @param slot_count the amount of frames the consumer may lag behind
+ * @param size the dimensions of the frames
+ * @param channels 3 for RGB888 frames, 1 for Grayscale8 frames
+ * @return true if the ring was created, see errorString() otherwise
+ */
+bool FrameRing::create(const QString &name, int slot_count, const QSize &size, int channels)
+{
+    close();
+#ifndef Q_OS_UNIX
+    Q_UNUSED(name);
+    Q_UNUSED(slot_count);
+    Q_UNUSED(size);
+    Q_UNUSED(channels);
+    m_error_string = "Shared memory output requires POSIX shared memory";
+    return false;
+#else
+    if(slot_count < 1 || !size.isValid() || (channels != 1 && channels != 3)) {
+        m_error_string = "Invalid shared memory ring";
+        return false;
+    }
+    qint64 bytes_per_line = ((qint64)size.width() * channels + 3) & ~3; // the scanline alignment of QImage
+    qint64 pixel_offset = aligned(sizeof(FrameHeader));
+    qint64 slot_size = aligned(pixel_offset + bytes_per_line * size.height());
+    m_size = aligned(sizeof(RingHeader)) + slot_count * slot_size;
+
+    QByteArray shared = sharedName(name);
+    if(!replaceable(shared)) {
+        m_error_string = "The shared memory is in use by another producer: " + name;
+        return false;
+    }
+    shm_unlink(shared.constData());
+    int fd = shm_open(shared.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0 || ftruncate(fd, (off_t)m_size) != 0) {
+        if(fd >= 0) ::close(fd);
+        m_error_string = "Unable to create the shared memory: " + name;
+        return false;
+    }
+    void *memory = mmap(nullptr, (size_t)m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(memory == MAP_FAILED) {
+        shm_unlink(shared.constData());
+        m_error_string = "Unable to map the shared memory: " + name;
+        return false;
+    }
+    m_memory = static_cast<uchar*>(memory);
+    m_header = new(m_memory) RingHeader;
+    m_header->slot_count = (quint32)slot_count;
+    m_header->slot_size = (quint32)slot_size;
+    m_header->pixel_offset = (quint32)pixel_offset;
+    m_header->consumer.store(0);
+    m_header->written.store(0);
+    m_header->read.store(0);
+    m_header->closed.store(0);
+    m_header->producer.store((qint32)getpid());
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, RING_MAGIC, sizeof(m_header->magic)); // a consumer checks it last
+    m_name = name;
+    m_owner = true;
+    return true;
+#endif
+}
+
+/**
+ * @brief FrameRing::attach
+ *
+ * Attaches to the ring of a producer as its consumer. The slots the header describes must lie
+ * within the shared memory, a ring without slots or with its pixels overlapping the frame
+ * headers is rejected.
+ *
+ * @param name the shared memory name passed to create()
+ * @return true if the ring was attached, see errorString() otherwise
+ */
+bool FrameRing::attach(const QString &name)
+{
+    close();
+#ifndef Q_OS_UNIX
+    Q_UNUSED(name);
+    m_error_string = "Shared memory output requires POSIX shared memory";
+    return false;
+#else
+    int fd = shm_open(sharedName(name).constData(), O_RDWR, 0);
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(RingHeader)) {
+        if(fd >= 0) ::close(fd);
+        m_error_string = "Unable to open the shared memory: " + name;
+        return false;
+    }
+    void *memory = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(memory == MAP_FAILED) {
+        m_error_string = "Unable to map the shared memory: " + name;
+        return false;
+    }
+    m_memory = static_cast<uchar*>(memory);
+    m_size = info.st_size;
+    m_header = reinterpret_cast<RingHeader*>(m_memory);
+    if(std::memcmp(m_header->magic, RING_MAGIC, sizeof(m_header->magic)) != 0) {
+        close();
+        m_error_string = "Not a frame ring: " + name;
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    qint64 slot_size = m_header->slot_size;
+    if(m_header->slot_count == 0 || m_header->pixel_offset < sizeof(FrameHeader) || m_header->pixel_offset > slot_size
+            || aligned(sizeof(RingHeader)) + m_header->slot_count * slot_size > m_size) {
+        close();
+        m_error_string = "Corrupt frame ring: " + name;
+        return false;
+    }
+    m_header->consumer.store((qint32)getpid(), std::memory_order_release);
+    m_name = name;
+    m_owner = false;
+    return true;
+#endif
+}
+
+/**
+ * @brief FrameRing::isOpen
+ * @return true if the ring was created or attached
+ */
+bool FrameRing::isOpen() const
+{
+    return m_header != nullptr;
+}
+
+/**
+ * @brief FrameRing::close
+ *
+ * Detaches from the ring. The producer marks the ring as closed and unlinks its name, the
+ * memory lives on until the consumer detaches as well, which clears its pid.
+ *
+ */
+void FrameRing::close()
+{
+#ifdef Q_OS_UNIX
+    if(!m_header) return;
+    if(m_owner) {
+        m_header->closed.store(1, std::memory_order_release);
+        shm_unlink(sharedName(m_name).constData());
+    } else {
+        qint32 consumer = (qint32)getpid();
+        m_header->consumer.compare_exchange_strong(consumer, 0);
+    }
+    munmap(m_memory, (size_t)m_size);
+#endif
+    m_memory = nullptr;
+    m_header = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+/**
+ * @brief FrameRing::errorString
+ * @return a description of the last error
+ */
+QString FrameRing::errorString() const
+{
+    return m_error_string;
+}
+
+/**
+ * @brief FrameRing::setTimeout
+ * @param msecs the time publish() waits for the consumer to release a frame of a full ring,
+ * 0 to wait as long as a consumer is attached and alive, a full ring without an attached
+ * consumer then fails at once, e.g. if none attached before or it detached early
+ */
+void FrameRing::setTimeout(int msecs)
+{
+    m_timeout = std::max(msecs, 0);
+}
+
+/**
+ * @brief FrameRing::timeout
+ * @return the time publish() waits for the consumer to release a frame, see setTimeout()
+ */
+int FrameRing::timeout() const
+{
+    return m_timeout;
+}
+
+/**
+ * @brief FrameRing::publish
+ *
+ * Copies a morph into the next slot and publishes it, waiting while every slot is unread.
+ * The wait fails if the consumer process is gone, or if it released no frame within
+ * timeout(), without a timeout if no consumer is attached.
+ *
+ * @param header the pair ids, alpha and landmarks of the frame, the remaining fields are
+ * filled in from the image
+ * @param image the morph, of the size and channels of create()
+ * @param canceled stops waiting for the consumer when set
+ * @return true if the frame was published
+ */
+bool FrameRing::publish(const FrameHeader &header, const QImage &image, const std::atomic<bool> &canceled)
+{
+    if(!m_header || !m_owner) {
+        m_error_string = "The ring is not open for publishing";
+        return false;
+    }
+    QImage frame = ImageBridge::processable(image);
+    int channels = frame.format() == QImage::Format_Grayscale8 ? 1 : 3;
+    qint64 bytes_per_line = ((qint64)frame.width() * channels + 3) & ~3;
+    if(m_header->pixel_offset + bytes_per_line * frame.height() > m_header->slot_size) {
+        m_error_string = "The frame does not fit the ring slots";
+        return false;
+    }
+    quint64 written = m_header->written.load(std::memory_order_relaxed);
+    quint64 read = m_header->read.load(std::memory_order_acquire);
+    QElapsedTimer waiting;
+    waiting.start();
+    while(written - read >= m_header->slot_count) {
+        if(canceled) {
+            m_error_string = "Canceled";
+            return false;
+        }
+        qint32 consumer = m_header->consumer.load(std::memory_order_acquire);
+        if(m_timeout == 0 && consumer == 0) {
+            // without a timeout only an attached consumer can release the full ring
+            m_error_string = "No shared memory consumer is attached to the full ring";
+            return false;
+        }
+#ifdef Q_OS_UNIX
+        if(processGone(consumer)) {
+            m_error_string = "The shared memory consumer " + QString::number(consumer) + " exited";
+            return false;
+        }
+#endif
+        if(m_timeout > 0 && waiting.elapsed() > m_timeout) {
+            m_error_string = "No shared memory consumer released a frame within " + QString::number(m_timeout) + " ms";
+            return false;
+        }
+        QThread::usleep(RING_POLL_INTERVAL); // the consumer lags, hold the job back
+        quint64 released = m_header->read.load(std::memory_order_acquire);
+        if(released != read) waiting.restart(); // a slow consumer still makes progress
+        read = released;
+    }
+    uchar *target = slot(written);
+    FrameHeader published = header;
+    published.sequence = written;
+    published.width = frame.width();
+    published.height = frame.height();
+    published.bytes_per_line = (qint32)bytes_per_line;
+    published.channels = channels;
+    std::memcpy(target, &published, sizeof(published));
+    for(int y = 0; y < frame.height(); ++y)
+        std::memcpy(target + m_header->pixel_offset + y * bytes_per_line, frame.constScanLine(y), (size_t)frame.width() * channels);
+    m_header->written.store(written + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief FrameRing::published
+ * @return the amount of frames published so far
+ */
+quint64 FrameRing::published() const
+{
+    return m_header ? m_header->written.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * @brief FrameRing::acquire
+ *
+ * The consumer side, wraps the oldest unreleased frame without copying it.
+ *
+ * @param image set to a read-only image over the pixels of the frame, valid until release()
+ * @param wait true to wait for a frame while the ring is not closed
+ * @return the header of the frame, nullptr if none is available or its header is corrupt
+ */
+const FrameHeader *FrameRing::acquire(QImage &image, bool wait)
+{
+    if(!m_header) return nullptr;
+    quint64 read = m_header->read.load(std::memory_order_relaxed);
+    while(m_header->written.load(std::memory_order_acquire) <= read) {
+        if(!wait || m_header->closed.load(std::memory_order_acquire)) {
+            // a frame published right before the ring was closed is still taken
+            if(m_header->written.load(std::memory_order_acquire) > read) break;
+            return nullptr;
+        }
+        QThread::usleep(RING_POLL_INTERVAL);
+    }
+    const uchar *source = slot(read);
+    const FrameHeader *header = reinterpret_cast<const FrameHeader*>(source);
+    qint64 line = (qint64)header->width * header->channels;
+    if(header->width <= 0 || header->height <= 0 || (header->channels != 1 && header->channels != 3)
+            || header->bytes_per_line < line
+            || m_header->pixel_offset + (qint64)header->bytes_per_line * header->height > m_header->slot_size) {
+        m_error_string = "Corrupt frame " + QString::number(read);
+        return nullptr;
+    }
+    image = QImage(source + m_header->pixel_offset, header->width, header->height, header->bytes_per_line,
+                   header->channels == 1 ? QImage::Format_Grayscale8 : ImageBridge::CANONICAL_FORMAT);
+    return header;
+}
+
+/**
+ * @brief FrameRing::release
+ *
+ * The consumer side, hands the slot of the acquired frame back to the producer.
+ *
+ */
+void FrameRing::release()
+{
+    if(m_header) m_header->read.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief FrameRing::setLandmarks
+ * @param header the header of a frame
+ * @param landmarks the landmarks of the morph, at most FRAME_MAX_LANDMARKS are kept
+ */
+void FrameRing::setLandmarks(FrameHeader &header, const std::vector<QPoint> &landmarks)
+{
+    header.landmark_count = (qint32)std::min(landmarks.size(), (size_t)FRAME_MAX_LANDMARKS);
+    for(int i = 0; i < header.landmark_count; ++i) {
+        header.landmarks[2 * i] = landmarks[i].x();
+        header.landmarks[2 * i + 1] = landmarks[i].y();
+    }
+}
+
+/**
+ * @brief FrameRing::slot
+ * @param index the sequence number of a frame
+ * @return the start of the slot of the frame
+ */
+uchar *FrameRing::slot(quint64 index) const
+{
+    return m_memory + aligned(sizeof(RingHeader)) + (index % m_header->slot_count) * m_header->slot_size;
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+
+#include <vector>
+
+#define FRAME_MAX_LANDMARKS 128
+
+namespace fmg {
+/**
+ * @brief The RingHeader struct
+ *
+ * The header at the start of the shared memory of a FrameRing. written counts the frames
+ * published by the producer, read the frames released by the consumer, frame i lives in
+ * slot i % slot_count. closed is set once the producer publishes no more frames. consumer
+ * is the pid of the attached consumer, 0 while none is attached, producer the pid of the
+ * process which created the ring.
+ */
+struct alignas(64) RingHeader
+{
+    char magic[8];                 // "FMGRING1"
+    quint32 slot_count;
+    quint32 slot_size;             // bytes per slot, FrameHeader included
+    quint32 pixel_offset;          // bytes from the start of a slot to its pixels
+    std::atomic<qint32> consumer;
+    std::atomic<quint64> written;
+    std::atomic<quint64> read;
+    std::atomic<quint32> closed;
+    std::atomic<qint32> producer;
+};
+
+/**
+ * @brief The FrameHeader struct
+ *
+ * The header of a published morph, followed by its raw scanlines at pixel_offset within
+ * the slot, RGB888 for 3 channels, Grayscale8 for 1 channel. The landmarks are the ones of
+ * the morphed face, x and y interleaved.
+ */
+struct FrameHeader
+{
+    quint64 sequence;
+    qint32 one;                    // the index of the first reference among the job images
+    qint32 two;
+    float alpha;
+    qint32 width;
+    qint32 height;
+    qint32 bytes_per_line;
+    qint32 channels;
+    qint32 landmark_count;
+    qint32 landmarks[2 * FRAME_MAX_LANDMARKS];
+};
+
+/**
+ * @brief The FrameRing class
+ *
+ * A single producer, single consumer ring of raw morphs in POSIX shared memory, such that
+ * a local consumer, e.g. a trainer, reads the morphs in place instead of decoding files.
+ * The layout is the RingHeader followed by slot_count slots, all in host byte order, the
+ * consumer attaches to the same name with shm_open() and mmap().
+ *
+ * A consumer reads frame read % slot_count once written > read, and increments read when
+ * it is done with the pixels. The producer waits while all slots are unread, hence a
+ * lagging consumer slows the job down rather than losing frames. A consumer records its pid
+ * in the header, the producer gives up waiting once that process is gone, or once no frame
+ * was released within timeout(), e.g. as no consumer ever attached. Without a timeout it
+ * gives up once no consumer is attached to the full ring. The pid is only meaningful if
+ * both share a pid namespace, the timeout applies regardless. The producer
+ * unlinks the name when it is closed, a consumer which attached before keeps reading the
+ * remaining frames until closed is set and read == written.
+ */
+class FrameRing
+{
+public:
+    FrameRing();
+    ~FrameRing();
+
+    bool create(const QString &name, int slot_count, const QSize &size, int channels);
+    bool attach(const QString &name);
+    bool isOpen() const;
+    void close();
+    QString errorString() const;
+    void setTimeout(int msecs);
+    int timeout() const;
+
+    bool publish(const FrameHeader &header, const QImage &image, const std::atomic<bool> &canceled);
+    quint64 published() const;
+    const FrameHeader *acquire(QImage &image, bool wait);
+    void release();
+
+    static void setLandmarks(FrameHeader &header, const std::vector<QPoint> &landmarks);
+
+private:
+    uchar *slot(quint64 index) const;
+
+private:
+    QString m_name;
+    bool m_owner;
+    uchar *m_memory;
+    qint64 m_size;
+    RingHeader *m_header;
+    int m_timeout; // msecs the producer waits for a full ring, 0 to wait while a consumer is attached and lives
+    QString m_error_string;
+};
+}
@@ -1,7 +0,0 @@
-#include "globals.h"
-
-namespace fmg {
-int Globals::img_width = 0;
-int Globals::img_height = 0;
-bool Globals::gui = false;
-}
@@ -1,9 +0,0 @@
-#pragma once
-
-namespace fmg {
-struct Globals {
-    static int img_width;
-    static int img_height;
-    static bool gui;
-};
-}
@@ -0,0 +1,177 @@
+#include "imagebridge.h"
+
+#include "pixelkernels.h"
+
+namespace fmg {
+/**
+ * @brief releaseMat
+ *
+ * The QImageCleanupFunction of ImageBridge::wrap(), releasing the reference held on the
+ * buffer of the wrapped cv::Mat.
+ *
+ * @param info the heap allocated cv::Mat header
+ */
+static void releaseMat(void *info)
+{
+    delete static_cast<cv::Mat*>(info);
+}
+
+/**
+ * @brief ImageBridge::canonical
+ *
+ * Normalizes an image to the canonical CANONICAL_FORMAT. Images already in the canonical
+ * format are returned as an implicitly shared copy, no pixels are converted or copied.
+ *
+ * @param image the input image
+ * @return the image in CANONICAL_FORMAT
+ */
+QImage ImageBridge::canonical(const QImage &image)
+{
+    if(image.isNull() || image.format() == CANONICAL_FORMAT) return image;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    if(image.format() == QImage::Format_BGR888) {
+        QImage converted(image.size(), CANONICAL_FORMAT);
+        const PixelKernels &kernels = PixelKernels::get();
+        for(int y = 0; y < image.height(); ++y) {
+            kernels.swapRedBlue(image.constScanLine(y), converted.scanLine(y), static_cast<std::size_t>(image.width()));
+        }
+        return converted;
+    }
+#endif
+    return image.convertToFormat(CANONICAL_FORMAT);
+}
+
+/**
+ * @brief ImageBridge::grayscale
+ *
+ * The QImage::Format_Grayscale8 variant of an image, using the qGray() weights. Canonical
+ * images are converted with the dispatched fmg::PixelKernels, other formats by Qt.
+ *
+ * @param image the input image
+ * @return the grayscale image
+ */
+QImage ImageBridge::grayscale(const QImage &image)
+{
+    if(image.isNull() || image.format() != CANONICAL_FORMAT) return image.convertToFormat(QImage::Format_Grayscale8);
+    QImage gray(image.size(), QImage::Format_Grayscale8);
+    const PixelKernels &kernels = PixelKernels::get();
+    for(int y = 0; y < image.height(); ++y) {
+        kernels.rgbToGray(image.constScanLine(y), gray.scanLine(y), static_cast<std::size_t>(image.width()));
+    }
+    return gray;
+}
+
+/**
+ * @brief ImageBridge::processable
+ *
+ * Normalizes an image to a format processed natively, grayscale images are kept as they
+ * are, every other format is converted to CANONICAL_FORMAT, see canonical().
+ *
+ * @param image the input image
+ * @return the image in QImage::Format_Grayscale8 or CANONICAL_FORMAT
+ */
+QImage ImageBridge::processable(const QImage &image)
+{
+    if(image.format() == QImage::Format_Grayscale8) return image;
+    return canonical(image);
+}
+
+/**
+ * @brief ImageBridge::view
+ *
+ * A writable cv::Mat header over the pixels of the image. The image is detached if its
+ * pixels are shared with other QImage instances.
+ *
+ * @param image the image, which must outlive the returned cv::Mat
+ * @return the cv::Mat view, or an empty cv::Mat if the format is not supported
+ */
+cv::Mat ImageBridge::view(QImage &image)
+{
+    int type = matType(image.format());
+    if(image.isNull() || type < 0) return cv::Mat();
+    return cv::Mat(image.height(), image.width(), type,
+                   image.bits(), static_cast<std::size_t>(image.bytesPerLine()));
+}
+
+/**
+ * @brief ImageBridge::constView
+ *
+ * A read-only cv::Mat header over the pixels of the image, the image is never detached.
+ * Writing through the returned cv::Mat is undefined behaviour.
+ *
+ * @param image the image, which must outlive the returned cv::Mat
+ * @return the cv::Mat view, or an empty cv::Mat if the format is not supported
+ */
+cv::Mat ImageBridge::constView(const QImage &image)
+{
+    int type = matType(image.format());
+    if(image.isNull() || type < 0) return cv::Mat();
+    return cv::Mat(image.height(), image.width(), type,
+                   const_cast<uchar*>(image.constBits()), static_cast<std::size_t>(image.bytesPerLine()));
+}
+
+/**
+ * @brief ImageBridge::wrap
+ *
+ * A QImage sharing the buffer of the cv::Mat, the QImage holds a reference on the buffer
+ * which is released when the last copy of the QImage is destroyed. Buffers which do not
+ * satisfy the 32-bit scanline alignment of QImage are copied instead.
+ *
+ * @param mat a CV_8UC1, CV_8UC3 or CV_8UC4 matrix
+ * @return the wrapping QImage, or a null QImage if the type is not supported
+ */
+QImage ImageBridge::wrap(const cv::Mat &mat)
+{
+    QImage::Format format = imageFormat(mat.type());
+    if(mat.empty() || format == QImage::Format_Invalid) return QImage();
+    if(mat.step % 4 != 0 || reinterpret_cast<std::size_t>(mat.data) % 4 != 0) {
+        QImage image(mat.cols, mat.rows, format);
+        cv::Mat destination = view(image);
+        mat.copyTo(destination);
+        return image;
+    }
+    cv::Mat *owner = new cv::Mat(mat);
+    return QImage(owner->data, owner->cols, owner->rows, static_cast<int>(owner->step),
+                  format, releaseMat, owner);
+}
+
+/**
+ * @brief ImageBridge::matType
+ * @param format a QImage::Format
+ * @return the cv::Mat type sharing the memory layout of format, -1 if none exists
+ */
+int ImageBridge::matType(QImage::Format format)
+{
+    switch(format) {
+    case QImage::Format_RGB888:
+        return CV_8UC3;
+    case QImage::Format_Grayscale8:
+        return CV_8UC1;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return CV_8UC4;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief ImageBridge::imageFormat
+ * @param mat_type a cv::Mat type
+ * @return the QImage::Format sharing the memory layout of mat_type, QImage::Format_Invalid if none exists
+ */
+QImage::Format ImageBridge::imageFormat(int mat_type)
+{
+    switch(mat_type) {
+    case CV_8UC3:
+        return QImage::Format_RGB888;
+    case CV_8UC1:
+        return QImage::Format_Grayscale8;
+    case CV_8UC4:
+        return QImage::Format_ARGB32;
+    default:
+        return QImage::Format_Invalid;
+    }
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QImage>
+
+#include <opencv2/core/core.hpp>
+
+namespace fmg {
+/**
+ * @brief The ImageBridge struct
+ *
+ * Conversions between QImage and cv::Mat. Images are normalized once, when they enter the
+ * application, to the canonical QImage::Format_RGB888 (CV_8UC3, RGB byte order); the derived
+ * grayscale images use QImage::Format_Grayscale8 (CV_8UC1). Both formats are bridged without
+ * copying pixels, and both are processed natively by the morph and filter routines, hence
+ * a grayscale job runs on a single channel from the morph onwards.
+ *
+ * Ownership: view() and constView() return cv::Mat headers borrowing the pixels of the QImage,
+ * they are valid as long as the QImage is alive and not reassigned. wrap() returns a QImage
+ * which shares, and keeps alive, the reference counted buffer of the cv::Mat.
+ */
+struct ImageBridge {
+    static const QImage::Format CANONICAL_FORMAT = QImage::Format_RGB888;
+
+    static QImage canonical(const QImage &image);
+    static QImage grayscale(const QImage &image);
+    static QImage processable(const QImage &image);
+
+    static cv::Mat view(QImage &image);
+    static cv::Mat constView(const QImage &image);
+    static QImage wrap(const cv::Mat &mat);
+
+    static int matType(QImage::Format format);
+    static QImage::Format imageFormat(int mat_type);
+};
+}
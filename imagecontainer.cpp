@@ -1,29 +1,21 @@
 #include "imagecontainer.h"
 
 #include "databasepreview.h"
-#include "globals.h"
 
+#include <QHideEvent>
 #include <QMouseEvent>
-#include <QRegExp>
-
-#include <QPainter>
-#include <QPen>
+#include <QShowEvent>
 
 /**
  * @brief ImageContainer::ImageContainer
  *
  * The ImageContainer ctor, constructs the controls for the ImageContainer
- * class and sets the internal Qt sizing policies of this widget. The ctor
- * also initially creates a random UUID used to uniquely identify the image
- * contained in this class. The UUID is regenerated when the image is changed
- * in any form or way.
+ * class and sets the internal Qt sizing policies of this widget.
  *
  * @param parent the Qt widgets parent of this widget
  */
 ImageContainer::ImageContainer(QWidget *parent) :
-    QLabel(parent),
-    m_contains_image(false),
-    m_id(QUuid::createUuid())
+    QLabel(parent)
 {
     setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
     setScaledContents(true);
@@ -40,17 +32,9 @@ ImageContainer::ImageContainer(QWidget *parent) :
  */
 ImageContainer::ImageContainer(const ImageContainer &other) :
     QLabel((QLabel*)other.parent()),
-    m_source(other.m_source),
-    m_temp_source(other.m_temp_source),
-    m_grayscale_source(other.m_grayscale_source),
-    m_landmark_image(other.m_landmark_image),
-    m_img_path(other.m_img_path),
-    m_img_title(other.m_img_title),
-    m_contains_image(other.m_contains_image),
+    FaceImage(other),
     m_isDisplayingLandmarks(other.m_isDisplayingLandmarks),
-    m_isDisplayingGrayscale(other.m_isDisplayingGrayscale),
-    m_landmarks(other.m_landmarks),
-    m_id(other.m_id) {}
+    m_isDisplayingGrayscale(other.m_isDisplayingGrayscale) {}
 
 /**
  * @brief ImageContainer::update
@@ -75,8 +59,9 @@ void ImageContainer::update(ImageContainer *other)
     m_isDisplayingLandmarks = other->m_isDisplayingLandmarks;
     m_isDisplayingGrayscale = other->m_isDisplayingGrayscale;
     m_landmarks = other->m_landmarks;
+    m_context = other->m_context;
     if(m_isDisplayingGrayscale)
-        setImage(m_grayscale_source);
+        setImage(getGrayscaleSource());
     else setImage(m_temp_source);
     setToolTip(m_img_title);
 }
@@ -89,18 +74,10 @@ void ImageContainer::update(ImageContainer *other)
  */
 void ImageContainer::reset()
 {
-    m_source = QImage();
-    m_temp_source = QImage();
-    m_grayscale_source = QImage();
-    m_landmark_image = QImage();
-    m_img_path = 0;
-    m_img_title = "";
-    m_contains_image = false;
+    FaceImage::reset();
     m_isDisplayingLandmarks = false;
     m_isDisplayingGrayscale = false;
-    m_landmarks.clear();
-    m_id = 0;
-    setPixmap(QPixmap::fromImage(m_source));
+    display(m_source);
 }
 
 /**
@@ -136,138 +113,40 @@ void ImageContainer::mousePressEvent(QMouseEvent *event)
 }
 
 /**
- * @brief ImageContainer::setImageSource
+ * @brief ImageContainer::sourceChanged
  *
- * Given a valid image file path, this method constructs an ImageContainer.
+ * Displays the new source image, invoked by FaceImage::setImageSource().
  *
- * @param path a valid image file path
- * @return true if construction was successful
  */
-bool ImageContainer::setImageSource(const QString &path)
+void ImageContainer::sourceChanged()
 {
-    auto loaded = m_source.load(path);
-    if(!loaded) return false;
-    m_source = m_source.scaled(fmg::Globals::img_width, fmg::Globals::img_height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-    m_temp_source = m_source;
-    m_grayscale_source = m_source.convertToFormat(QImage::Format_Grayscale8);
-    m_img_path = path;
-    m_img_title = m_img_path.toString();
-    m_img_title.replace(QRegExp("(.jpg)|(.png)|(.jpeg)"),"");
-    m_img_title.replace(QRegExp(".*/"),"");
-    m_contains_image = true;
-    resize(size());
-    setPixmap(QPixmap::fromImage(m_source));
-    setToolTip(m_img_title);
-    return true;
-}
-
-/**
- * @brief ImageContainer::setImageSource
- *
- * Given a notNull() QImage source, this method constructs an ImageContainer.
- *
- * @param source a notNull() QImage source
- */
-void ImageContainer::setImageSource(const QImage &source)
-{
-    m_source = source.copy();
-    m_temp_source = m_source;
-    m_grayscale_source = source.convertToFormat(QImage::Format_Grayscale8);
-    m_contains_image = true;
     m_isDisplayingGrayscale = false;
     resize(size());
-    setPixmap(QPixmap::fromImage(m_source));
+    display(m_source);
     setToolTip(m_img_title);
 }
 
 /**
- * @brief ImageContainer::setImage
+ * @brief ImageContainer::imageChanged
  *
- * A public class method to update the image contained in this ImageContainer. Futhermore
- * the method creates a grayscale version copy of the input image.
+ * Displays the new processed image, invoked by FaceImage::setImage().
  *
- * @param image a QImage updating this view
  */
-void ImageContainer::setImage(const QImage &image)
+void ImageContainer::imageChanged()
 {
-    m_temp_source = image;
-    m_grayscale_source = m_temp_source.convertToFormat(QImage::Format_Grayscale8);
-    m_contains_image = true;
     resize(size());
-    setPixmap(QPixmap::fromImage(m_temp_source));
+    display(m_temp_source);
 }
 
 /**
- * @brief ImageContainer::setLandmarks
+ * @brief ImageContainer::landmarksChanged
  *
- * Sets the detected image landmarks and adds 8 extra landmarks to the corners/midpoints of
- * the scaled source image if desired.
+ * Invoked by FaceImage::setLandmarks(), the previous landmark overlay is no longer displayed.
  *
- * @param landmarks the set of detected facial features.
- * @param extra_landmarks true if 8 additional landmarks is wanted.
  */
-void ImageContainer::setLandmarks(const std::vector<QPoint> &landmarks, bool extra_landmarks)
+void ImageContainer::landmarksChanged()
 {
     m_isDisplayingLandmarks = false;
-    m_landmarks = landmarks;
-    if(extra_landmarks) {
-        m_landmarks.push_back(QPoint(0, 0)); // top-left
-        m_landmarks.push_back(QPoint(m_source.width() - 1, 0)); // top-right
-        m_landmarks.push_back(QPoint(0, m_source.height() - 1)); // bot-left
-        m_landmarks.push_back(QPoint(m_source.width() - 1, m_source.height() - 1)); // bot-right
-
-        m_landmarks.push_back(QPoint(0, m_source.height() / 2)); // mid-left
-        m_landmarks.push_back(QPoint(m_source.width() / 2, 0)); // mid-top
-        m_landmarks.push_back(QPoint(m_source.width() - 1, m_source.height() / 2)); // mid-right
-        m_landmarks.push_back(QPoint(m_source.width() / 2, m_source.height() - 1)); // mid-bot
-    }
-    generateLandmarkImage();
-}
-
-/**
- * @brief ImageContainer::hasBadLandmarks
- *
- * A public method to determine whether the contained image contains artificial landmarks,
- * i.e. landmarks which are not within the boundaries of the image.
- *
- * @return
- */
-bool ImageContainer::hasBadLandmarks()
-{
-    if(m_landmarks.empty()) return true; // no landmarks to iterate
-    QRect test(0, 0, fmg::Globals::img_width, fmg::Globals::img_height);
-    for(const auto &point : m_landmarks) {
-        if(!test.contains(point)) return true;
-    }
-    return false;
-}
-
-/**
- * @brief ImageContainer::generateLandmarkImage
- *
- * A convenience private method to generate a landmark overlay for the source image.
- *
- */
-void ImageContainer::generateLandmarkImage()
-{
-    QImage res(m_source.size(), QImage::Format_ARGB32);
-    QPainter painter(&res);
-    QPen pen;
-    pen.setCapStyle(Qt::RoundCap);
-
-    painter.setPen(pen);
-    painter.drawImage(QRect(0, 0, res.width(), res.height()), m_source, QRect(0, 0, res.width(), res.height()));
-    int i = 0;
-    for(const QPoint & landmark : m_landmarks) {
-        pen.setColor(Qt::blue);
-        pen.setWidth(3);
-        painter.setPen(pen);
-        painter.drawPoint(landmark);
-        pen.setColor(Qt::red);
-        painter.setPen(pen);
-        painter.drawText(landmark, QString::number(++i));
-    }
-    m_landmark_image = res;
 }
 
 /**
@@ -280,7 +159,7 @@ void ImageContainer::displayOriginal()
 {
     if(m_source.isNull()) return;
     resize(size());
-    setPixmap(QPixmap::fromImage(m_source));
+    display(m_source);
     m_isDisplayingLandmarks = false;
     m_isDisplayingGrayscale = false;
 }
@@ -293,10 +172,12 @@ void ImageContainer::displayOriginal()
  */
 void ImageContainer::displayLandmarks()
 {
-    if(m_landmark_image.isNull()) return;
+    QImage landmark_image = getLandmarkImage();
+    if(landmark_image.isNull()) return;
     resize(size());
-    m_temp_source = m_landmark_image;
-    setPixmap(QPixmap::fromImage(m_landmark_image));
+    getGrayscaleSource(); // the grayscale variant remains the one of the processed image
+    m_temp_source = landmark_image;
+    display(landmark_image);
     m_isDisplayingLandmarks = true;
 }
 
@@ -308,9 +189,10 @@ void ImageContainer::displayLandmarks()
  */
 void ImageContainer::displayGrayscale()
 {
-    if(m_grayscale_source.isNull()) return;
+    QImage grayscale = getGrayscaleSource();
+    if(grayscale.isNull()) return;
     resize(size());
-    setPixmap(QPixmap::fromImage(m_grayscale_source));
+    display(grayscale);
     m_isDisplayingGrayscale = true;
 }
 
@@ -330,111 +212,52 @@ void ImageContainer::toggleLandmarks()
 }
 
 /**
- * @brief ImageContainer::getSource
- * @return m_source
- */
-QImage ImageContainer::getSource()
-{
-    return m_source;
-}
-
-/**
- * @brief ImageContainer::getTempSource
- * @return m_temp_source
- */
-QImage ImageContainer::getTempSource()
-{
-    return m_temp_source;
-}
-
-/**
- * @brief ImageContainer::getGrayscaleSource
- * @return m_grayscale_source
- */
-QImage ImageContainer::getGrayscaleSource()
-{
-    return m_grayscale_source;
-}
-
-/**
- * @brief ImageContainer::getImagePath
- * @return m_img_path
- */
-QUrl ImageContainer::getImagePath()
-{
-   return m_img_path;
-}
-
-/**
- * @brief ImageContainer::getImageTitle
- * @return m_img_title
- */
-QString ImageContainer::getImageTitle()
-{
-    return m_img_title;
-}
-
-/**
- * @brief ImageContainer::setImageTitle
- * @param title
- */
-void ImageContainer::setImageTitle(const QString &title)
-{
-    m_img_title = title;
-}
-
-/**
- * @brief ImageContainer::hasImage
- * @return m_contains_image
- */
-bool ImageContainer::hasImage()
-{
-   return m_contains_image;
-}
-
-/**
- * @brief ImageContainer::getLandmarks
- * @return m_landmarks
- */
-std::vector<QPoint> ImageContainer::getLandmarks()
-{
-    return m_landmarks;
-}
-
-/**
- * @brief ImageContainer::hasLandmarks
- * @return !m_landmarks.empty()
+ * @brief ImageContainer::isDisplayingGrayscale
+ * @param b
  */
-bool ImageContainer::hasLandmarks()
+void ImageContainer::isDisplayingGrayscale(bool b)
 {
-    return !m_landmarks.empty();
+    m_isDisplayingGrayscale = b;
 }
 
 /**
- * @brief ImageContainer::isDisplayingGrayscale
- * @param b
+ * @brief ImageContainer::showEvent
+ *
+ * Converts the displayed image to the pixmap, which is deferred while the container is
+ * hidden.
+ *
+ * @param event the show event
  */
-void ImageContainer::isDisplayingGrayscale(bool b)
+void ImageContainer::showEvent(QShowEvent *event)
 {
-    m_isDisplayingGrayscale = b;
+    QLabel::showEvent(event);
+    if(!event->spontaneous()) setPixmap(QPixmap::fromImage(m_displayed_image));
 }
 
 /**
- * @brief ImageContainer::updateId
+ * @brief ImageContainer::hideEvent
  *
- * A public method to update the UUID of this ImageContainer
+ * Releases the pixmap of a container hidden by the application, the displayed image is
+ * kept and converted again by showEvent(). A minimized window keeps its pixmaps.
  *
+ * @param event the hide event
  */
-void ImageContainer::updateId()
+void ImageContainer::hideEvent(QHideEvent *event)
 {
-    m_id = QUuid::createUuid();
+    QLabel::hideEvent(event);
+    if(!event->spontaneous()) setPixmap(QPixmap());
 }
 
 /**
- * @brief ImageContainer::getId
- * @return m_id.toString() (QString)
+ * @brief ImageContainer::display
+ *
+ * A private convenience method to display an image, the pixmap is only created while the
+ * container is visible, see showEvent().
+ *
+ * @param image the image to be displayed
  */
-QString ImageContainer::getId()
+void ImageContainer::display(const QImage &image)
 {
-    return m_id.toString();
+    m_displayed_image = image;
+    if(isVisible()) setPixmap(QPixmap::fromImage(image));
 }
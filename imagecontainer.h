@@ -2,16 +2,16 @@
 
 #include <QLabel>
 
-#include <vector>
+#include "faceimage.h"
 
-#include <QUrl>
-#include <QImage>
-#include <QPoint>
-#include <QString>
-#include <QUuid>
 #include <QScrollArea>
 
-class ImageContainer : public QLabel
+/**
+ * @brief The ImageContainer class
+ *
+ * The QLabel view of a FaceImage, refreshed through the FaceImage change hooks.
+ */
+class ImageContainer : public QLabel, public FaceImage
 {
     Q_OBJECT
 public:
@@ -31,16 +31,12 @@ public:
     void mouseDoubleClickEvent(QMouseEvent *);
     void mousePressEvent(QMouseEvent *event);
 
-    bool setImageSource(const QString &path);
-    void setImageSource(const QImage &source);
-    void setImage(const QImage &image);
-
-    void setLandmarks(const std::vector<QPoint> & landmarks,
-                      bool extra_landmarks = true);
-    bool hasBadLandmarks();
-
-private:
-    void generateLandmarkImage();
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void sourceChanged() override;
+    void imageChanged() override;
+    void landmarksChanged() override;
 
 public:
     void displayOriginal();
@@ -49,33 +45,13 @@ public:
     void toggleLandmarks();
 
 public:
-    QImage getSource();
-    QImage getTempSource();
-    QImage getGrayscaleSource();
-    QUrl getImagePath();
-    QString getImageTitle();
-    void setImageTitle(const QString &title);
-    bool hasImage();
-    std::vector<QPoint> getLandmarks();
-    bool hasLandmarks();
     void isDisplayingGrayscale(bool);
-    void updateId();
-    QString getId();
 
 private:
-    QImage m_source;
-    QImage m_temp_source;
-    QImage m_grayscale_source;
-    QImage m_landmark_image;
-
-    QUrl m_img_path;
-    QString m_img_title;
+    void display(const QImage &image);
 
-    bool m_contains_image;
+private:
+    QImage m_displayed_image; // converted to the pixmap while the container is visible
     bool m_isDisplayingLandmarks = false;
     bool m_isDisplayingGrayscale = false;
-
-    std::vector<QPoint> m_landmarks;
-
-    QUuid m_id;
 };
@@ -0,0 +1,287 @@
+#include "imageencoder.h"
+
+#include <algorithm>
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFutureInterface>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#define DEFAULT_ENCODER_THREADS 2
+
+namespace fmg {
+/**
+ * @brief ImageEncoder::ImageEncoder
+ *
+ * The ImageEncoder ctor, JPEG with the default quality of Qt on DEFAULT_ENCODER_THREADS
+ * threads.
+ *
+ */
+ImageEncoder::ImageEncoder() :
+    m_format(JPEG),
+    m_jpeg_quality(-1),
+    m_png_compression(-1),
+    m_threads(DEFAULT_ENCODER_THREADS),
+    m_write_files(true),
+    m_encoded(0),
+    m_encode_nsecs(0)
+{
+    m_pool.setMaxThreadCount(m_threads);
+}
+
+/**
+ * @brief ImageEncoder::~ImageEncoder
+ *
+ * Waits for the submitted images, an image is never left half written.
+ *
+ */
+ImageEncoder::~ImageEncoder()
+{
+    m_pool.waitForDone();
+}
+
+/**
+ * @brief ImageEncoder::setFormat
+ * @param format the output Format
+ */
+void ImageEncoder::setFormat(Format format)
+{
+    m_format = format;
+}
+
+/**
+ * @brief ImageEncoder::format
+ * @return the output Format
+ */
+ImageEncoder::Format ImageEncoder::format() const
+{
+    return m_format;
+}
+
+/**
+ * @brief ImageEncoder::setJpegQuality
+ * @param quality RANGE: [0,100], -1 for the default quality of Qt
+ */
+void ImageEncoder::setJpegQuality(int quality)
+{
+    m_jpeg_quality = quality < 0 ? -1 : std::min(quality, 100);
+}
+
+/**
+ * @brief ImageEncoder::setPngCompression
+ * @param level RANGE: [0,9] the zlib compression level, 0 is fastest, -1 for the default
+ */
+void ImageEncoder::setPngCompression(int level)
+{
+    m_png_compression = level < 0 ? -1 : std::min(level, 9);
+}
+
+/**
+ * @brief ImageEncoder::setThreads
+ *
+ * Sets the threads of the encoder, the images submitted before are still taken back.
+ *
+ * @param threads the amount of encoder threads, 0 to encode on the submitting thread
+ */
+void ImageEncoder::setThreads(int threads)
+{
+    m_threads = std::max(threads, 0);
+    if(m_threads > 0) m_pool.setMaxThreadCount(m_threads);
+}
+
+/**
+ * @brief ImageEncoder::threads
+ * @return the amount of encoder threads, 0 if images are encoded on the submitting thread
+ */
+int ImageEncoder::threads() const
+{
+    return m_threads;
+}
+
+/**
+ * @brief ImageEncoder::extension
+ * @param grayscale true if the images are grayscale, PNM distinguishes PGM from PPM
+ * @return the file name extension of the format, including the dot
+ */
+QString ImageEncoder::extension(bool grayscale) const
+{
+    switch(m_format) {
+    case PNG:
+        return ".png";
+    case PNM:
+        return grayscale ? ".pgm" : ".ppm";
+    default:
+        return ".jpg";
+    }
+}
+
+/**
+ * @brief ImageEncoder::setWriteFiles
+ *
+ * Selects whether the images are saved to their paths or only encoded, the encoded content
+ * is then returned in EncodedImage::data, e.g. to be appended to a ResultArchive.
+ *
+ * @param write true to save the images, the default
+ */
+void ImageEncoder::setWriteFiles(bool write)
+{
+    m_write_files = write;
+}
+
+/**
+ * @brief ImageEncoder::submit
+ *
+ * Submits an image to be encoded and saved, the image is shared rather than copied.
+ *
+ * @param image the image, in any format supported by QImageWriter
+ * @param path the output file path
+ */
+void ImageEncoder::submit(const QImage &image, const QString &path)
+{
+    if(m_threads == 0) {
+        QFutureInterface<EncodedImage> saved;
+        saved.reportStarted();
+        saved.reportResult(save(image, path));
+        saved.reportFinished();
+        m_pending.append(saved.future());
+        return;
+    }
+    m_pending.append(QtConcurrent::run(&m_pool, [this, image, path]() { return save(image, path); }));
+}
+
+/**
+ * @brief ImageEncoder::takeResult
+ *
+ * Takes the outcome of the oldest submitted image.
+ *
+ * @param result the outcome
+ * @param wait true to wait for the oldest image to be saved
+ * @return true if an outcome was taken, false if none is pending or, without wait, the
+ * oldest image is not saved yet
+ */
+bool ImageEncoder::takeResult(EncodedImage &result, bool wait)
+{
+    if(m_pending.isEmpty()) return false;
+    if(!wait && !m_pending.first().isFinished()) return false;
+    result = m_pending.takeFirst().result();
+    return true;
+}
+
+/**
+ * @brief ImageEncoder::pending
+ * @return the amount of submitted images whose outcome was not taken yet
+ */
+int ImageEncoder::pending() const
+{
+    return m_pending.size();
+}
+
+/**
+ * @brief ImageEncoder::waitForAll
+ *
+ * Waits until every submitted image is saved, the outcomes are still taken by takeResult().
+ *
+ */
+void ImageEncoder::waitForAll()
+{
+    for(QFuture<EncodedImage> &future : m_pending) future.waitForFinished();
+}
+
+/**
+ * @brief ImageEncoder::encoded
+ * @return the amount of images encoded since resetStatistics()
+ */
+int ImageEncoder::encoded() const
+{
+    return m_encoded;
+}
+
+/**
+ * @brief ImageEncoder::encodeSeconds
+ * @return the time spent encoding and saving since resetStatistics(), summed over the threads
+ */
+double ImageEncoder::encodeSeconds() const
+{
+    return m_encode_nsecs / 1e9;
+}
+
+/**
+ * @brief ImageEncoder::resetStatistics
+ */
+void ImageEncoder::resetStatistics()
+{
+    m_encoded = 0;
+    m_encode_nsecs = 0;
+}
+
+/**
+ * @brief ImageEncoder::encode
+ *
+ * Encodes an image in memory. The PNG compression level is passed as the equivalent
+ * quality of the Qt PNG writer, which maps quality q to the level (100 - q) * 9 / 91.
+ *
+ * @param image the image
+ * @param format the output Format
+ * @param jpeg_quality RANGE: [0,100], -1 for the default
+ * @param png_compression RANGE: [0,9], -1 for the default
+ * @return the encoded file content, empty on failure
+ */
+QByteArray ImageEncoder::encode(const QImage &image, Format format, int jpeg_quality, int png_compression)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "jpg");
+    switch(format) {
+    case PNG:
+        writer.setFormat("png");
+        if(png_compression >= 0) writer.setQuality(100 - (png_compression * 91 + 8) / 9);
+        break;
+    case PNM:
+        writer.setFormat(image.format() == QImage::Format_Grayscale8 ? "pgm" : "ppm");
+        break;
+    default:
+        if(jpeg_quality >= 0) writer.setQuality(jpeg_quality);
+        break;
+    }
+    if(!writer.write(image)) return QByteArray();
+    return data;
+}
+
+/**
+ * @brief ImageEncoder::save
+ *
+ * A private convenience method encoding an image and saving it atomically, a crash never
+ * leaves a truncated file behind the final name. The digest is computed from the encoded
+ * bytes, the file is not read back. Without writing files the bytes are returned instead.
+ *
+ * @param image the image
+ * @param path the output file path
+ * @return the outcome
+ */
+EncodedImage ImageEncoder::save(const QImage &image, const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+    EncodedImage result;
+    result.path = path;
+    QByteArray data = encode(image, m_format, m_jpeg_quality, m_png_compression);
+    bool saved = !data.isEmpty();
+    if(saved && m_write_files) {
+        QSaveFile file(path);
+        saved = file.open(QIODevice::WriteOnly);
+        saved = saved && file.write(data) == data.size();
+        saved = saved && file.commit();
+    } else {
+        result.data = data;
+    }
+    if(saved) result.digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+    else result.error = "Failed to save: " + path;
+    m_encode_nsecs += timer.nsecsElapsed();
+    ++m_encoded;
+    return result;
+}
+}
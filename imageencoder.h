@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+
+#include <QByteArray>
+#include <QFuture>
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+
+namespace fmg {
+/**
+ * @brief The EncodedImage struct
+ * The outcome of encoding and saving one image.
+ */
+struct EncodedImage
+{
+    QString path;      // the saved file
+    QByteArray digest; // the hex encoded sha1 of the saved file, empty on failure
+    QString error;     // empty on success
+    QByteArray data;   // the encoded file content, only if files are not written
+};
+
+/**
+ * @brief The ImageEncoder class
+ *
+ * The encoder stage of the morph pipeline. Images are encoded and saved atomically on a
+ * thread pool of its own while the caller keeps morphing, the outcomes are taken back in
+ * submission order, see takeResult(). With 0 threads the images are encoded by submit(),
+ * e.g. in a forked process, which must not rely on the threads of its parent.
+ *
+ * The JPEG quality and the PNG compression level are configurable, PNM writes the raw
+ * pixels, as PPM or, for grayscale images, PGM, for pipelines which decode the results
+ * again. The time spent encoding is accumulated across the threads, see encodeSeconds().
+ * Without writing files the encoded content is handed back instead, see setWriteFiles().
+ */
+class ImageEncoder
+{
+public:
+    enum Format {
+        JPEG, PNG, PNM
+    };
+
+    ImageEncoder();
+    ~ImageEncoder();
+
+    void setFormat(Format format);
+    Format format() const;
+    void setJpegQuality(int quality);
+    void setPngCompression(int level);
+    void setThreads(int threads);
+    int threads() const;
+    QString extension(bool grayscale) const;
+    void setWriteFiles(bool write);
+
+    void submit(const QImage &image, const QString &path);
+    bool takeResult(EncodedImage &result, bool wait);
+    int pending() const;
+    void waitForAll();
+
+    int encoded() const;
+    double encodeSeconds() const;
+    void resetStatistics();
+
+    static QByteArray encode(const QImage &image, Format format, int jpeg_quality, int png_compression);
+
+private:
+    EncodedImage save(const QImage &image, const QString &path);
+
+private:
+    Format m_format;
+    int m_jpeg_quality;
+    int m_png_compression;
+    int m_threads;
+    bool m_write_files;
+    QThreadPool m_pool;
+    QList<QFuture<EncodedImage>> m_pending; // in submission order
+    std::atomic<int> m_encoded;
+    std::atomic<qint64> m_encode_nsecs;
+};
+}
@@ -0,0 +1,63 @@
+#include "imageprobe.h"
+
+#include "imagesource.h"
+
+#include <algorithm>
+
+#include <QImageReader>
+#include <QScopedPointer>
+#include <QtConcurrent>
+
+namespace fmg {
+/**
+ * @brief ImageProbe::size
+ *
+ * Reads the dimensions of an image from its header. The few formats which do not expose
+ * their dimensions without decoding are decoded instead.
+ *
+ * @param path the image file path or archive member, see ImageSource
+ * @return the dimensions of the image, invalid if the file is not a readable image
+ */
+QSize ImageProbe::size(const QString &path)
+{
+    QScopedPointer<QIODevice> device(ImageSource::open(path));
+    QImageReader reader(device.data());
+    QSize size = reader.size();
+    if(size.isValid()) return size;
+    return reader.read().size();
+}
+
+/**
+ * @brief ImageProbe::sizes
+ * @param paths the image file paths
+ * @return the dimensions of every image, in the order of the paths
+ */
+QList<QSize> ImageProbe::sizes(const QStringList &paths)
+{
+    return QtConcurrent::blockingMapped<QList<QSize>>(paths, &ImageProbe::size);
+}
+
+/**
+ * @brief ImageProbe::minimumSize
+ *
+ * Determines the lowest width and the lowest height among the images, i.e. the suggested
+ * resolution of a job, see fmg::MorphContext.
+ *
+ * @param paths the image file paths
+ * @param unreadable set to the first path which is not a readable image
+ * @return the lowest dimensions, invalid if no paths were given or an image is unreadable
+ */
+QSize ImageProbe::minimumSize(const QStringList &paths, QString *unreadable)
+{
+    QList<QSize> dimensions = sizes(paths);
+    QSize minimum;
+    for(int i = 0; i < dimensions.size(); ++i) {
+        if(!dimensions[i].isValid()) {
+            if(unreadable) *unreadable = paths[i];
+            return QSize();
+        }
+        minimum = minimum.isValid() ? minimum.boundedTo(dimensions[i]) : dimensions[i];
+    }
+    return minimum;
+}
+}
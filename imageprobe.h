@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+namespace fmg {
+/**
+ * @brief The ImageProbe struct
+ *
+ * Reads the dimensions of image files from their headers, without decoding the pixels,
+ * hence an image is decoded once, when it is loaded for the job. Several files are probed
+ * in parallel by the global QThreadPool.
+ */
+struct ImageProbe {
+    static QSize size(const QString &path);
+    static QList<QSize> sizes(const QStringList &paths);
+    static QSize minimumSize(const QStringList &paths, QString *unreadable = nullptr);
+};
+}
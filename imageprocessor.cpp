@@ -1,9 +1,12 @@
 #include "imageprocessor.h"
 
-#include "imagecontainer.h"
-#include "console.h"
-#include "globals.h"
+#include "faceimage.h"
+#include "imagebridge.h"
+#include "pixelkernels.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <string>
 #include <unordered_set>
 #include <iostream>
@@ -11,26 +14,66 @@
 #include <QDebug>
 #include <QImage>
 #include <QUuid>
-#include <QProgressDialog>
 #include <QCoreApplication>
 #include <QString>
 
 /**
  * @brief ImageProcessor::ImageProcessor
  *
- * The ImageProcessor default ctor, deserializing the shape_predictor_68_face_landmarks.dat training set to
- * perform facial feature extraction in 1 millisecond according:
+ * The ImageProcessor default ctor, acquiring the shape_predictor_68_face_landmarks.dat training set
+ * to perform facial feature extraction in 1 millisecond according:
  *
  * https://www.semanticscholar.org/paper/One-millisecond-face-alignment-with-an-ensemble-of-Kazemi-Sullivan/1824b1ccace464ba275ccc86619feaa89018c0ad
  * https://github.com/davisking/dlib-models
  *
- * @param parent the Qt widgets parent
+ * @param parent the Qt parent
  */
-ImageProcessor::ImageProcessor(QWidget *parent)
-    : QWidget(parent)
+ImageProcessor::ImageProcessor(QObject *parent)
+    : QObject(parent),
+      sp(sharedShapePredictor()),
+      m_spectrum_key(0),
+      m_planes_key(0) {}
+
+/**
+ * @brief ImageProcessor::sharedShapePredictor
+ *
+ * The shape_predictor is deserialized once per process, on first use, and shared by every
+ * ImageProcessor. Predicting landmarks does not modify it, hence it may be used by several
+ * jobs and threads concurrently.
+ *
+ * @return the shared shape_predictor
+ */
+std::shared_ptr<const dlib::shape_predictor> ImageProcessor::sharedShapePredictor()
+{
+    static const std::shared_ptr<const dlib::shape_predictor> predictor = []() {
+        auto loaded = std::make_shared<dlib::shape_predictor>();
+        QString path = QCoreApplication::applicationDirPath() + "/" + "shape_predictor_68_face_landmarks.dat";
+        dlib::deserialize(path.toStdString()) >> *loaded;
+        return std::shared_ptr<const dlib::shape_predictor>(loaded);
+    }();
+    return predictor;
+}
+
+/**
+ * @brief ImageProcessor::setParallelThreads
+ *
+ * Sets the amount of threads used by the OpenCV routines of every ImageProcessor, 0 runs
+ * them sequentially, which is required before a process forks, see MorphPreforker::run.
+ *
+ * @param threads the amount of threads, -1 restores the OpenCV default
+ */
+void ImageProcessor::setParallelThreads(int threads)
+{
+    cv::setNumThreads(threads);
+}
+
+/**
+ * @brief ImageProcessor::parallelThreads
+ * @return the amount of threads used by the OpenCV routines, see setParallelThreads()
+ */
+int ImageProcessor::parallelThreads()
 {
-    QString path = QCoreApplication::applicationDirPath() + "/" + "shape_predictor_68_face_landmarks.dat";
-    dlib::deserialize(path.toStdString()) >> sp;
+    return cv::getNumThreads();
 }
 
 /**
@@ -45,32 +88,35 @@ ImageProcessor::ImageProcessor(QWidget *parent)
  * Furthermore for future extension https://github.com/nenadmarkus/pico/ would dramatically increase the face
  * detection procedure.
  *
- * @param image the ImageContainer to perform facial feature extraction on
+ * @param image the FaceImage to perform facial feature extraction on
  * @return a std::vector<QPoint> containing the extracted facial features
  */
-std::vector<QPoint> ImageProcessor::getFacialFeatures(ImageContainer *image)
+std::vector<QPoint> ImageProcessor::getFacialFeatures(FaceImage *image)
 {
     #define FACE_DOWNSAMPLE_RATIO 2
-    if(fmg::Globals::gui)
-        Console::appendToConsole("Detecting facial landmarks: " + image->getImageTitle());
+    emit message("Detecting facial landmarks: " + image->getImageTitle());
     std::vector<QPoint> landmarks;
     dlib::frontal_face_detector detector = dlib::get_frontal_face_detector();
 
-    cv::Mat cv_img = img2mat(image->getSource());
-    dlib::array2d<dlib::rgb_pixel> img;
-    dlib::assign_image(img, dlib::cv_image<dlib::bgr_pixel>(cv_img));
+    QImage source = fmg::ImageBridge::canonical(image->getSource());
+    cv::Mat cv_img = fmg::ImageBridge::constView(source);
+    dlib::cv_image<dlib::rgb_pixel> img(cv_img);
 
     cv::Mat image_small;
     cv::resize(cv_img, image_small, cv::Size(), 1.0/FACE_DOWNSAMPLE_RATIO, 1.0/FACE_DOWNSAMPLE_RATIO);
 
-    dlib::cv_image<dlib::bgr_pixel> dlib_small(image_small);
+    dlib::cv_image<dlib::rgb_pixel> dlib_small(image_small);
 
     std::vector<dlib::rectangle> faces = detector(dlib_small);
+    if(faces.empty()) {
+        qWarning() << "failed to detect a face";
+        return landmarks;
+    }
     dlib::rectangle rect((long)(faces[0].left()   * FACE_DOWNSAMPLE_RATIO),
                          (long)(faces[0].top()    * FACE_DOWNSAMPLE_RATIO),
                          (long)(faces[0].right()  * FACE_DOWNSAMPLE_RATIO),
                          (long)(faces[0].bottom() * FACE_DOWNSAMPLE_RATIO));
-    dlib::full_object_detection shape = sp(img, rect);
+    dlib::full_object_detection shape = (*sp)(img, rect);
 
     if(shape.num_parts() < 68) {
         qWarning() << "failed to get 68 facial landmarks";
@@ -88,29 +134,40 @@ std::vector<QPoint> ImageProcessor::getFacialFeatures(ImageContainer *image)
 /**
  * @brief ImageProcessor::morphImages
  *
- * A routine to morph two the images contained in two ImageContainers to one image.
+ * A routine to morph two the images contained in two FaceImages to one image.
  * The routine calculates the average facial landmarks, triangulates the result,
  * translates the triangulation to the reference landmarks and finally warps and alpha
  * blends the resulting triangle sets into one morphed image. This procedure is described
  * in detail in the term paper.
  *
- * @param ref_one the ImageContainer of the Reference One image
- * @param ref_two the ImageContainer of the Reference Two image
- * @param target
+ * A grayscale morph warps and blends the grayscale images of the references, derived once
+ * per reference, and produces a QImage::Format_Grayscale8 target, a third of the work of
+ * morphing the color images and converting the result.
+ *
+ * @param ref_one the FaceImage of the Reference One image
+ * @param ref_two the FaceImage of the Reference Two image
+ * @param target the FaceImage receiving the morphed image and its landmarks
  * @param alpha the alpha-blend value 0-1
+ * @param context the job defining the resolution of the morph
+ * @param grayscale true to morph a single grayscale channel
  */
-void ImageProcessor::morphImages(ImageContainer *ref_one,
-                                 ImageContainer *ref_two,
-                                 ImageContainer *target,
-                                 float alpha)
+void ImageProcessor::morphImages(FaceImage *ref_one,
+                                 FaceImage *ref_two,
+                                 FaceImage *target,
+                                 float alpha,
+                                 const fmg::MorphContext &context,
+                                 bool grayscale)
 {
-    cv::Mat cv_ref_one = img2mat(ref_one->getSource());
-    cv::Mat cv_ref_two = img2mat(ref_two->getSource());
+    QImage source_one = grayscale ? ref_one->getGrayscaleSource()
+                                  : fmg::ImageBridge::canonical(ref_one->getSource());
+    QImage source_two = grayscale ? ref_two->getGrayscaleSource()
+                                  : fmg::ImageBridge::canonical(ref_two->getSource());
 
-    cv_ref_one.convertTo(cv_ref_one, CV_32F);
-    cv_ref_two.convertTo(cv_ref_two, CV_32F);
+    cv::Mat cv_ref_one, cv_ref_two;
+    fmg::ImageBridge::constView(source_one).convertTo(cv_ref_one, CV_32F);
+    fmg::ImageBridge::constView(source_two).convertTo(cv_ref_two, CV_32F);
 
-    cv::Mat morphed_image = cv::Mat::zeros(cv_ref_one.size(), CV_32FC3);
+    cv::Mat morphed_image = cv::Mat::zeros(cv_ref_one.size(), CV_MAKETYPE(CV_32F, cv_ref_one.channels()));
 
     std::vector<cv::Point2f> average_landmarks;
     std::vector<cv::Point2f> average_weighted_landmarks;
@@ -128,10 +185,10 @@ void ImageProcessor::morphImages(ImageContainer *ref_one,
         average_landmarks.push_back(cv::Point2f(x_a, y_a));
     }
 
-    auto triangles = delaunayTriangulation(average_landmarks, fmg::Globals::img_width, fmg::Globals::img_height);
+    auto triangles = delaunayTriangulation(average_landmarks, context.img_width, context.img_height);
 
     std::unordered_set<std::string> errors;
-    cv::Rect test(0, 0, fmg::Globals::img_width, fmg::Globals::img_height);
+    cv::Rect test(0, 0, context.img_width, context.img_height);
     for(const auto &triangle : triangles) {
         std::vector<cv::Point2f> t_one, t_two, t_target;
 
@@ -181,13 +238,13 @@ void ImageProcessor::morphImages(ImageContainer *ref_one,
 
         warpAndAlphaBlendTriangles(cv_ref_one, cv_ref_two, morphed_image, t_one, t_two, t_target, alpha);
     }
-    if(fmg::Globals::gui) {
-        for(const auto &error : errors) {
-            Console::appendToConsole(QString::fromStdString(error));
-        }
+    for(const auto &error : errors) {
+        emit message(QString::fromStdString(error));
     }
-    morphed_image.convertTo(morphed_image, CV_8UC4);
-    QImage morph_result = mat2img(morphed_image);
+    QImage morph_result(morphed_image.cols, morphed_image.rows,
+                        grayscale ? QImage::Format_Grayscale8 : fmg::ImageBridge::CANONICAL_FORMAT);
+    cv::Mat morph_result_view = fmg::ImageBridge::view(morph_result);
+    morphed_image.convertTo(morph_result_view, CV_8U);
     QString morph_title = "(" + ref_one->getImageTitle() + ")" + "_x_" + "(" + ref_two->getImageTitle() + ")";
     target->setImageTitle(morph_title);
     target->setImageSource(morph_result);
@@ -202,7 +259,8 @@ void ImageProcessor::morphImages(ImageContainer *ref_one,
  * @brief ImageProcessor::applyFilter
  *
  * A procedure to apply a filter specified by the Filter enum, to the target QImage with the
- * given intensity.
+ * given intensity. The filters read from and write to the pixels of canonical and grayscale
+ * images directly, see fmg::ImageBridge::processable().
  *
  * @param target the reference to the QImage
  * @param filter the Filter to be applied
@@ -211,10 +269,10 @@ void ImageProcessor::morphImages(ImageContainer *ref_one,
 void ImageProcessor::applyFilter(QImage &target, Filter filter, int intensity)
 {
     if(intensity <= 2) return;
-    cv::Mat before = img2mat(target);
-    cv::Mat destination = cv::Mat::zeros(target.height(),
-                                         target.width(),
-                                         before.type());
+    QImage source = fmg::ImageBridge::processable(target);
+    QImage filtered(source.size(), source.format());
+    cv::Mat before = fmg::ImageBridge::constView(source);
+    cv::Mat destination = fmg::ImageBridge::view(filtered);
     int intensity_i = ceil(intensity) / 3;
     switch(filter) {
     case HOMOGENEOUS:
@@ -222,7 +280,7 @@ void ImageProcessor::applyFilter(QImage &target, Filter filter, int intensity)
         break;
     case GAUSSIAN:
         if(intensity_i %2 == 0) intensity_i++;
-        cv::GaussianBlur(before, destination, cv::Size(intensity_i, intensity_i), 0, 0);
+        gaussianBlur(before, destination, intensity_i, 0);
         break;
     case MEDIAN:
         if(intensity_i % 2 == 0) intensity_i++;
@@ -232,17 +290,197 @@ void ImageProcessor::applyFilter(QImage &target, Filter filter, int intensity)
         cv::bilateralFilter(before, destination, intensity_i, intensity_i * 2, intensity_i / 2);
         break;
     case SHARPNESS:
-        cv::GaussianBlur(before, destination, cv::Size(0, 0), intensity_i);
+        gaussianBlur(before, destination, 0, intensity_i);
         cv::addWeighted(before, 1.5, destination, -0.5, 0, destination);
         break;
     case CONTRAST:
-        before.convertTo(destination, -1, (1 + (float)intensity/100), 0);
+        scaleShift(before, destination, 1 + (float)intensity / 100, 0);
         break;
     case BRIGHTNESS:
-        before.convertTo(destination, -1, 1, intensity);
+        scaleShift(before, destination, 1, intensity);
         break;
     }
-    target = MatToQImage(destination, QImage::Format_RGB888).rgbSwapped();
+    target = filtered;
+}
+
+/**
+ * @brief ImageProcessor::spectralFilter
+ *
+ * A procedure to filter the target QImage in the frequency domain. Every color channel is
+ * transformed with a real-input dft, the CCS-packed spectra are multiplied with the mask
+ * and transformed back to the spatial domain.
+ *
+ * The radii are normalized such that 1 corresponds to the nyquist frequency along an axis:
+ * LOW_PASS keeps the frequencies below cutoff, HIGH_PASS the frequencies above cutoff,
+ * BAND_PASS the ring cutoff +/- width/2 and NOTCH rejects that ring. The zero frequency is
+ * always kept, preserving the mean intensity of the result.
+ *
+ * The spectra are cached by the QImage::cacheKey() of the input, hence trying several masks
+ * on an unchanged image costs one forward transform and one inverse transform per mask.
+ *
+ * @param target the reference to the QImage
+ * @param mask the SpectralMask to be applied
+ * @param cutoff the normalized cutoff radius
+ * @param width the normalized width of the band, ignored by LOW_PASS and HIGH_PASS
+ */
+void ImageProcessor::spectralFilter(QImage &target, SpectralMask mask, float cutoff, float width)
+{
+    if(target.isNull() || mask == NO_MASK) return;
+    const qint64 key = target.cacheKey();
+    if(key != m_planes_key || m_planes.empty()) {
+        QImage source = fmg::ImageBridge::processable(target);
+        cv::Mat cv_img = fmg::ImageBridge::constView(source);
+        int m = evenOptimalDFTSize(cv_img.rows);
+        int n = evenOptimalDFTSize(cv_img.cols);
+        std::vector<cv::Mat> channels;
+        cv::split(cv_img, channels);
+        m_planes.clear();
+        for(const cv::Mat &channel : channels) {
+            cv::Mat padded;
+            cv::copyMakeBorder(channel, padded, 0, m - channel.rows, 0, n - channel.cols, cv::BORDER_REFLECT);
+            padded.convertTo(padded, CV_32F);
+            cv::Mat spectrum;
+            cv::dft(padded, spectrum);
+            m_planes.push_back(spectrum);
+        }
+        m_planes_size = cv_img.size();
+        m_planes_key = key;
+    }
+
+    cv::Mat weights = spectralWeights(m_planes[0].size(), mask, cutoff, width);
+    std::vector<cv::Mat> channels;
+    for(const cv::Mat &spectrum : m_planes) {
+        cv::Mat filtered;
+        cv::multiply(spectrum, weights, filtered);
+        cv::dft(filtered, filtered, cv::DFT_INVERSE | cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+        cv::Mat channel;
+        filtered(cv::Rect(0, 0, m_planes_size.width, m_planes_size.height)).convertTo(channel, CV_8U);
+        channels.push_back(channel);
+    }
+    QImage filtered(m_planes_size.width, m_planes_size.height,
+                    m_planes.size() == 1 ? QImage::Format_Grayscale8 : fmg::ImageBridge::CANONICAL_FORMAT);
+    cv::Mat result = fmg::ImageBridge::view(filtered);
+    cv::merge(channels, result);
+    target = filtered;
+}
+
+/**
+ * @brief ImageProcessor::scaleShift
+ *
+ * The saturating linear transform of cv::Mat::convertTo(destination, -1, scale, shift) on
+ * 8-bit images, computed row by row with the dispatched fmg::PixelKernels.
+ *
+ * @param source the 8-bit source matrix
+ * @param destination the preallocated destination of the size and type of source
+ * @param scale the scale factor
+ * @param shift the value added after scaling
+ */
+void ImageProcessor::scaleShift(const cv::Mat &source, cv::Mat &destination, float scale, float shift)
+{
+    const fmg::PixelKernels &kernels = fmg::PixelKernels::get();
+    const std::size_t row_length = static_cast<std::size_t>(source.cols) * source.channels();
+    for(int y = 0; y < source.rows; ++y) {
+        kernels.scaleShift(source.ptr<uchar>(y), destination.ptr<uchar>(y), row_length, scale, shift);
+    }
+}
+
+/**
+ * @brief ImageProcessor::gaussianBlur
+ *
+ * A private filtering method with the semantics of cv::GaussianBlur, i.e. the sigma is derived from
+ * the kernel size if sigma <= 0. The spatial convolution grows linearly with the kernel size, hence
+ * once sigma passes RECURSIVE_GAUSSIAN_SIGMA the filtering is delegated to recursiveGaussianBlur(),
+ * whose cost is constant in sigma.
+ *
+ * @param source the image to be filtered
+ * @param destination the filtered output
+ * @param ksize the odd kernel size, or 0 to derive it from sigma
+ * @param sigma the standard deviation, or 0 to derive it from ksize
+ */
+void ImageProcessor::gaussianBlur(const cv::Mat &source, cv::Mat &destination, int ksize, double sigma)
+{
+    #define RECURSIVE_GAUSSIAN_SIGMA 4.0
+    if(sigma <= 0) sigma = 0.3 * ((ksize - 1) * 0.5 - 1) + 0.8;
+    if(sigma >= RECURSIVE_GAUSSIAN_SIGMA) {
+        recursiveGaussianBlur(source, destination, sigma);
+    } else {
+        cv::GaussianBlur(source, destination, cv::Size(ksize, ksize), sigma, sigma);
+    }
+}
+
+/**
+ * @brief ImageProcessor::recursiveGaussianBlur
+ *
+ * A recursive (IIR) approximation of the gaussian blur, performing a causal and an anti-causal
+ * third order pass in each direction, as described in:
+ *
+ * I.T. Young, L.J. van Vliet, "Recursive implementation of the Gaussian filter", Signal Processing 44 (1995)
+ *
+ * The borders are extended by replication. The vertical passes process entire rows at a time to
+ * keep the memory access sequential.
+ *
+ * @param source the image to be filtered
+ * @param destination the filtered output, of the same type as source
+ * @param sigma the standard deviation, the approximation is accurate for sigma >= 1
+ */
+void ImageProcessor::recursiveGaussianBlur(const cv::Mat &source, cv::Mat &destination, double sigma)
+{
+    const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                  : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    const double q2 = q * q;
+    const double q3 = q2 * q;
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    const float b1 = (float)((2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0);
+    const float b2 = (float)(-(1.4281 * q2 + 1.26661 * q3) / b0);
+    const float b3 = (float)(0.422205 * q3 / b0);
+    const float B = 1.0f - (b1 + b2 + b3);
+
+    cv::Mat work;
+    source.convertTo(work, CV_MAKETYPE(CV_32F, source.channels()));
+    const int rows = work.rows;
+    const int cols = work.cols;
+    const int channels = work.channels();
+    const int width = cols * channels;
+
+    for(int y = 0; y < rows; ++y) {
+        float *row = work.ptr<float>(y);
+        for(int c = 0; c < channels; ++c) {
+            float *d = row + c;
+            for(int x = 1; x < cols; ++x) {
+                const float p1 = d[(x - 1) * channels];
+                const float p2 = d[std::max(x - 2, 0) * channels];
+                const float p3 = d[std::max(x - 3, 0) * channels];
+                d[x * channels] = B * d[x * channels] + b1 * p1 + b2 * p2 + b3 * p3;
+            }
+            for(int x = cols - 2; x >= 0; --x) {
+                const float p1 = d[(x + 1) * channels];
+                const float p2 = d[std::min(x + 2, cols - 1) * channels];
+                const float p3 = d[std::min(x + 3, cols - 1) * channels];
+                d[x * channels] = B * d[x * channels] + b1 * p1 + b2 * p2 + b3 * p3;
+            }
+        }
+    }
+
+    for(int y = 1; y < rows; ++y) {
+        float *d = work.ptr<float>(y);
+        const float *p1 = work.ptr<float>(y - 1);
+        const float *p2 = work.ptr<float>(std::max(y - 2, 0));
+        const float *p3 = work.ptr<float>(std::max(y - 3, 0));
+        for(int x = 0; x < width; ++x) {
+            d[x] = B * d[x] + b1 * p1[x] + b2 * p2[x] + b3 * p3[x];
+        }
+    }
+    for(int y = rows - 2; y >= 0; --y) {
+        float *d = work.ptr<float>(y);
+        const float *p1 = work.ptr<float>(y + 1);
+        const float *p2 = work.ptr<float>(std::min(y + 2, rows - 1));
+        const float *p3 = work.ptr<float>(std::min(y + 3, rows - 1));
+        for(int x = 0; x < width; ++x) {
+            d[x] = B * d[x] + b1 * p1[x] + b2 * p2[x] + b3 * p3[x];
+        }
+    }
+
+    work.convertTo(destination, source.type());
 }
 
 /**
@@ -253,51 +491,184 @@ void ImageProcessor::applyFilter(QImage &target, Filter filter, int intensity)
  *
  * https://docs.opencv.org/2.4.13.4/doc/tutorials/core/discrete_fourier_transform/discrete_fourier_transform.html
  *
+ * The grayscale image is transformed with a real-input dft, producing a CCS-packed spectrum
+ * of half the size of the equivalent complex transform. The magnitude, logarithm and quadrant
+ * swap are evaluated in a single pass over the packed spectrum, see renderLogMagnitude().
+ *
+ * The spectrum and its rendering are cached by the QImage::cacheKey() of the input, hence
+ * requesting the frequency domain of an unchanged image does not recompute the transform.
+ *
  * @param target
  */
 void ImageProcessor::fourierTransform(QImage &target)
 {
-    cv::Mat cv_img = img2mat(target.convertToFormat(QImage::Format_Grayscale8));
-    cv::Mat padded_cv_img;
-    int m = cv::getOptimalDFTSize(cv_img.rows);
-    int n = cv::getOptimalDFTSize(cv_img.cols);
-    cv::copyMakeBorder(cv_img, padded_cv_img, 0, m - cv_img.rows, 0, n - cv_img.cols, cv::BORDER_CONSTANT, cv::Scalar::all(0));
-    cv::Mat planes[] = {cv::Mat_<float>(padded_cv_img), cv::Mat::zeros(padded_cv_img.size(), CV_32F)};
-    cv::Mat complexI;
-    cv::merge(planes, 2, complexI);
-
-    cv::dft(complexI, complexI);
-
-    cv::split(complexI, planes);
-    cv::magnitude(planes[0], planes[1], planes[0]);
-    cv::Mat magI = planes[0];
+    if(target.isNull()) return;
+    const qint64 key = target.cacheKey();
+    if(key == m_spectrum_key && !m_spectrum_image.isNull()) {
+        target = m_spectrum_image;
+        return;
+    }
 
-    magI += cv::Scalar::all(1);
-    cv::log(magI, magI);
+    QImage grayscale = target.convertToFormat(QImage::Format_Grayscale8);
+    cv::Mat cv_img = fmg::ImageBridge::constView(grayscale);
+    int m = evenOptimalDFTSize(cv_img.rows);
+    int n = evenOptimalDFTSize(cv_img.cols);
+    cv::Mat padded = cv::Mat::zeros(m, n, CV_32F);
+    cv_img.convertTo(padded(cv::Rect(0, 0, cv_img.cols, cv_img.rows)), CV_32F);
 
-    magI = magI(cv::Rect(0, 0, magI.cols & -2, magI.rows & -2));
+    cv::dft(padded, m_spectrum);
 
-    int cx = magI.cols/2;
-    int cy = magI.rows/2;
+    m_spectrum_key = key;
+    m_spectrum_image = fmg::ImageBridge::wrap(renderLogMagnitude(m_spectrum));
+    target = m_spectrum_image;
+}
 
-    cv::Mat q0(magI, cv::Rect(0, 0, cx, cy));
-    cv::Mat q1(magI, cv::Rect(cx, 0, cx, cy));
-    cv::Mat q2(magI, cv::Rect(0, cy, cx, cy));
-    cv::Mat q3(magI, cv::Rect(cx, cy, cx, cy));
+/**
+ * @brief ImageProcessor::evenOptimalDFTSize
+ *
+ * A private convenience method returning the smallest size >= n which cv::dft processes
+ * efficiently and which is even. Even dimensions keep the CCS-packed layout regular and
+ * allow an exact quadrant swap of the spectrum.
+ *
+ * @param n the minimum size
+ * @return an even, dft-friendly size
+ */
+int ImageProcessor::evenOptimalDFTSize(int n)
+{
+    int size = cv::getOptimalDFTSize(n);
+    while(size % 2 != 0) size = cv::getOptimalDFTSize(size + 1);
+    return size;
+}
 
-    cv::Mat tmp;
-    q0.copyTo(tmp);
-    q3.copyTo(q0);
-    tmp.copyTo(q3);
+/**
+ * @brief ImageProcessor::ccsMagnitude
+ *
+ * A private convenience method reading the magnitude of the (u, v) frequency from a CCS-packed
+ * spectrum of even dimensions, the conjugate-symmetric half which is not stored in the packed
+ * format is resolved by mirroring the coordinates.
+ *
+ * https://docs.opencv.org/3.4.1/d2/de8/group__core__array.html#gadd6cf9baf2b8b704a11b5f04aaf4f39d
+ *
+ * @param ccs the CCS-packed spectrum
+ * @param u the row frequency
+ * @param v the column frequency
+ * @return |F(u, v)|
+ */
+float ImageProcessor::ccsMagnitude(const cv::Mat &ccs, int u, int v)
+{
+    const int rows = ccs.rows;
+    const int cols = ccs.cols;
+    if(v > cols / 2) {
+        v = cols - v;
+        u = (rows - u) % rows;
+    }
+    float re, im;
+    if(v == 0 || v == cols / 2) {
+        const int c = v == 0 ? 0 : cols - 1;
+        if(u > rows / 2) u = rows - u;
+        if(u == 0) {
+            re = ccs.at<float>(0, c);
+            im = 0.0f;
+        } else if(u == rows / 2) {
+            re = ccs.at<float>(rows - 1, c);
+            im = 0.0f;
+        } else {
+            re = ccs.at<float>(2 * u - 1, c);
+            im = ccs.at<float>(2 * u, c);
+        }
+    } else {
+        const float *row = ccs.ptr<float>(u);
+        re = row[2 * v - 1];
+        im = row[2 * v];
+    }
+    return std::sqrt(re * re + im * im);
+}
 
-    q1.copyTo(tmp);
-    q2.copyTo(q1);
-    tmp.copyTo(q2);
+/**
+ * @brief ImageProcessor::renderLogMagnitude
+ *
+ * A private method rendering a CCS-packed spectrum as an 8-bit log-magnitude image with the
+ * zero frequency centered. The magnitude, log(1 + |F|) and quadrant swap are fused into a single
+ * pass tracking the value range, followed by one scaling pass replacing cv::normalize.
+ *
+ * @param ccs the CCS-packed spectrum of even dimensions
+ * @return a CV_8UC1 rendering of the spectrum
+ */
+cv::Mat ImageProcessor::renderLogMagnitude(const cv::Mat &ccs)
+{
+    const int rows = ccs.rows;
+    const int cols = ccs.cols;
+    const int cy = rows / 2;
+    const int cx = cols / 2;
+    cv::Mat log_magnitude(rows, cols, CV_32F);
+    float min_val = std::numeric_limits<float>::max();
+    float max_val = 0.0f;
+    for(int y = 0; y < rows; ++y) {
+        float *out = log_magnitude.ptr<float>(y);
+        const int u = y < cy ? y + cy : y - cy;
+        for(int x = 0; x < cols; ++x) {
+            const int v = x < cx ? x + cx : x - cx;
+            const float value = std::log(1.0f + ccsMagnitude(ccs, u, v));
+            out[x] = value;
+            min_val = std::min(min_val, value);
+            max_val = std::max(max_val, value);
+        }
+    }
+    cv::Mat rendered;
+    const double range = max_val - min_val;
+    const double scale = range > 0 ? 255.0 / range : 0.0;
+    log_magnitude.convertTo(rendered, CV_8U, scale, -min_val * scale);
+    return rendered;
+}
 
-    cv::normalize(magI, magI, 0, 255, CV_MINMAX);
-    magI.convertTo(magI, CV_8UC3);
+/**
+ * @brief ImageProcessor::spectralWeights
+ *
+ * A private method creating the weights of a SpectralMask in the CCS-packed layout, such that
+ * the mask can be applied to a packed spectrum by a per-element multiplication. The masks are
+ * radially symmetric, hence a packed coefficient and its conjugate share the same weight.
+ *
+ * @param size the size of the CCS-packed spectrum, both dimensions even
+ * @param mask the SpectralMask
+ * @param cutoff the normalized cutoff radius
+ * @param width the normalized width of the band
+ * @return a CV_32F matrix of weights in [0, 1]
+ */
+cv::Mat ImageProcessor::spectralWeights(const cv::Size &size, SpectralMask mask, float cutoff, float width)
+{
+    const int rows = size.height;
+    const int cols = size.width;
+    auto weight = [&](int u, int v) {
+        if(u == 0 && v == 0) return 1.0f;
+        const float du = (float)std::min(u, rows - u) / (rows / 2);
+        const float dv = (float)std::min(v, cols - v) / (cols / 2);
+        const float radius = std::sqrt(du * du + dv * dv);
+        const bool in_band = std::fabs(radius - cutoff) <= width / 2;
+        switch(mask) {
+        case LOW_PASS:
+            return radius <= cutoff ? 1.0f : 0.0f;
+        case HIGH_PASS:
+            return radius >= cutoff ? 1.0f : 0.0f;
+        case BAND_PASS:
+            return in_band ? 1.0f : 0.0f;
+        case NOTCH:
+            return in_band ? 0.0f : 1.0f;
+        default:
+            return 1.0f;
+        }
+    };
 
-    target = mat2img(magI);
+    cv::Mat weights(rows, cols, CV_32F);
+    for(int y = 0; y < rows; ++y) {
+        float *row = weights.ptr<float>(y);
+        const int edge_u = y == 0 ? 0 : (y == rows - 1 ? rows / 2 : (y + 1) / 2);
+        row[0] = weight(edge_u, 0);
+        row[cols - 1] = weight(edge_u, cols / 2);
+        for(int x = 1; x < cols - 1; ++x) {
+            row[x] = weight(y, (x + 1) / 2);
+        }
+    }
+    return weights;
 }
 
 /**
@@ -401,7 +772,8 @@ void ImageProcessor::warpAndAlphaBlendTriangles(const cv::Mat &cv_ref_one,
         cv_ref_two_offset.push_back(cv::Point2f(t_two[i].x - cv_ref_two_bounding_rect.x, t_two[i].y - cv_ref_two_bounding_rect.y));
     }
 
-    cv::Mat mask = cv::Mat::zeros(cv_morphed_image_bounding_rect.height, cv_morphed_image_bounding_rect.width, CV_32FC3);
+    cv::Mat mask = cv::Mat::zeros(cv_morphed_image_bounding_rect.height, cv_morphed_image_bounding_rect.width,
+                                  CV_MAKETYPE(CV_32F, cv_ref_one.channels()));
     cv::fillConvexPoly(mask, rect_ints, cv::Scalar(1.0, 1.0, 1.0), 16, 0);
 
     cv::Mat cv_ref_one_rect, cv_ref_two_rect;
@@ -418,89 +790,12 @@ void ImageProcessor::warpAndAlphaBlendTriangles(const cv::Mat &cv_ref_one,
     affineTransform(warp_ref_one, cv_ref_one_rect, cv_ref_one_offset, cv_target_offset);
     affineTransform(warp_ref_two, cv_ref_two_rect, cv_ref_two_offset, cv_target_offset);
 
-    cv::Mat image_rect = (1.0 - alpha) * warp_ref_one + alpha * warp_ref_two;
-
-    cv::multiply(image_rect, mask, image_rect);
-    cv::multiply(morphed_image(cv_morphed_image_bounding_rect), cv::Scalar(1.0, 1.0, 1.0) - mask, morphed_image(cv_morphed_image_bounding_rect));
-
-    morphed_image(cv_morphed_image_bounding_rect) += image_rect;
-}
-
-/**
- * @brief ImageProcessor::MatToQImage
- *
- * A private rescue-method used in some cases for a specfic cv::Mat to QImage conversion.
- *
- * @param mat
- * @param format
- * @return
- */
-QImage ImageProcessor::MatToQImage(const cv::Mat &mat, QImage::Format format)
-{
-    return QImage(mat.data, mat.cols, mat.rows,
-                  mat.step, format).copy();
-}
-
-/**
- * @brief ImageProcessor::qImageToCVMat
- *
- * A procedure to convert a QImage to a cv::Mat
- * The procedure is inspired by: https://asmaloney.com/2013/11/code/converting-between-cvmat-and-qimage-or-qpixmap/
- *
- * @param qimg imput image
- * @param copy specifies if the procedure should return a copy
- * @return the converted image
- */
-cv::Mat ImageProcessor::img2mat(const QImage &qimg, bool copy)
-{
-    cv::Mat image;
-    if(qimg.format() == QImage::Format_ARGB32 || qimg.format() == QImage::Format_ARGB32_Premultiplied) {
-        cv::Mat cvimg(qimg.height(), qimg.width(), CV_8UC4, const_cast<uchar*>(qimg.bits()), static_cast<std::size_t>(qimg.bytesPerLine()));
-        image = copy ? cvimg.clone() : cvimg;
-    } else if(qimg.format() == QImage::Format_RGB32) {
-        cv::Mat cvimg(qimg.height(), qimg.width(), CV_8UC4, const_cast<uchar*>(qimg.bits()), static_cast<std::size_t>(qimg.bytesPerLine()));
-        cv::Mat no_alpha;
-        cv::cvtColor(cvimg, no_alpha, cv::COLOR_BGRA2BGR);
-        image = copy ? no_alpha.clone() : no_alpha;
-    } else if(qimg.format() == QImage::Format_RGB888) {
-        QImage swap_rgb_qimage = qimg.rgbSwapped();
-        image = cv::Mat(swap_rgb_qimage.height(), swap_rgb_qimage.width(), CV_8UC3, const_cast<uchar*>(swap_rgb_qimage.bits()), static_cast<std::size_t>(swap_rgb_qimage.bytesPerLine())).clone();
-    } else if(qimg.format() == QImage::Format_Grayscale8) {
-        cv::Mat cvimg(qimg.height(), qimg.width(), CV_8UC1, const_cast<uchar*>(qimg.bits()), static_cast<std::size_t>(qimg.bytesPerLine()));
-        image = copy ? cvimg.clone() : cvimg;
-    }
-    return image;
-}
-
-/**
- * @brief ImageProcessor::cvMatToQImage
- *
- * A procedure to convert a cv::Mat to a QImage
- * The procedure is inspired by: https://asmaloney.com/2013/11/code/converting-between-cvmat-and-qimage-or-qpixmap/
- *
- * @param img input image
- * @return converted image
- */
-QImage ImageProcessor::mat2img(const cv::Mat &img)
-{
-    QImage image;
-    if(img.type() == CV_8UC4) {
-        image = QImage(img.data,
-                       img.cols, img.rows,
-                       static_cast<int>(img.step),
-                       QImage::Format_ARGB32);
-    } else if(img.type() == CV_8UC3) {
-        image = QImage(img.data,
-                       img.cols, img.rows,
-                       static_cast<int>(img.step),
-                       QImage::Format_RGB888).rgbSwapped();
-    } else if(img.type() == CV_8UC1) {
-        image = QImage(img.data,
-                       img.cols, img.rows,
-                       static_cast<int>(img.step),
-                       QImage::Format_Grayscale8);
+    // blend, mask and accumulate in one pass per row rather than four full-size temporaries
+    const fmg::PixelKernels &kernels = fmg::PixelKernels::get();
+    cv::Mat target_rect = morphed_image(cv_morphed_image_bounding_rect);
+    const std::size_t row_length = static_cast<std::size_t>(target_rect.cols) * target_rect.channels();
+    for(int y = 0; y < target_rect.rows; ++y) {
+        kernels.blend(warp_ref_one.ptr<float>(y), warp_ref_two.ptr<float>(y), mask.ptr<float>(y),
+                      target_rect.ptr<float>(y), row_length, alpha);
     }
-    return image;
 }
-
-
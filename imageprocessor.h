@@ -1,10 +1,12 @@
 #pragma once
-#include <QWidget>
+#include <QObject>
 
+#include <memory>
 #include <vector>
 
 #include <QImage>
 #include <QPoint>
+#include <QString>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <dlib/image_processing/frontal_face_detector.h>
@@ -22,13 +24,15 @@ struct TriangleIndices
     unsigned long B;
     unsigned long C;
 };
-class ImageContainer;
-class ImageProcessor : public QWidget
+#include "morphcontext.h"
+
+class FaceImage;
+class ImageProcessor : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ImageProcessor(QWidget * parent = nullptr);
+    explicit ImageProcessor(QObject * parent = nullptr);
     ~ImageProcessor() = default;
 
     enum Filter {
@@ -36,16 +40,36 @@ public:
         CONTRAST, BRIGHTNESS
     };
 
+    enum SpectralMask {
+        NO_MASK, LOW_PASS, HIGH_PASS, BAND_PASS, NOTCH
+    };
+
+signals:
+    void message(const QString &text);
+
 public:
-    std::vector<QPoint> getFacialFeatures(ImageContainer *image);
-    void morphImages(ImageContainer *ref_one,
-                     ImageContainer *ref_two,
-                     ImageContainer *target,
-                     float alpha);
+    std::vector<QPoint> getFacialFeatures(FaceImage *image);
+    void morphImages(FaceImage *ref_one,
+                     FaceImage *ref_two,
+                     FaceImage *target,
+                     float alpha,
+                     const fmg::MorphContext &context,
+                     bool grayscale = false);
     void applyFilter(QImage &target, Filter filter, int intensity);
     void fourierTransform(QImage &target);
+    void spectralFilter(QImage &target, SpectralMask mask, float cutoff, float width);
+    static void setParallelThreads(int threads);
+    static int parallelThreads();
 
 private:
+    static std::shared_ptr<const dlib::shape_predictor> sharedShapePredictor();
+    void scaleShift(const cv::Mat &source, cv::Mat &destination, float scale, float shift);
+    void gaussianBlur(const cv::Mat &source, cv::Mat &destination, int ksize, double sigma);
+    void recursiveGaussianBlur(const cv::Mat &source, cv::Mat &destination, double sigma);
+    int evenOptimalDFTSize(int n);
+    float ccsMagnitude(const cv::Mat &ccs, int u, int v);
+    cv::Mat renderLogMagnitude(const cv::Mat &ccs);
+    cv::Mat spectralWeights(const cv::Size &size, SpectralMask mask, float cutoff, float width);
     std::vector<TriangleIndices> delaunayTriangulation(const std::vector<cv::Point2f> &indices,
                                                        int width, int height);
     void affineTransform(const cv::Mat &target,
@@ -61,10 +85,13 @@ private:
                                        float alpha);
 
 private:
-    QImage MatToQImage(const cv::Mat &mat, QImage::Format format);
-    cv::Mat img2mat(const QImage &qimg, bool copy = true);
-    QImage mat2img(const cv::Mat &img);
+    std::shared_ptr<const dlib::shape_predictor> sp;
 
-private:
-    dlib::shape_predictor sp;
+    qint64 m_spectrum_key;
+    cv::Mat m_spectrum;
+    QImage m_spectrum_image;
+
+    qint64 m_planes_key;
+    cv::Size m_planes_size;
+    std::vector<cv::Mat> m_planes;
 };
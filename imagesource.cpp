@@ -0,0 +1,221 @@
+#include "imagesource.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRegExp>
+
+#define TAR_BLOCK 512
+
+namespace fmg {
+/**
+ * @brief isImageName
+ * @param name a file name
+ * @return true if the name has one of the image suffixes of a job
+ */
+static bool isImageName(const QString &name)
+{
+    QString suffix = QFileInfo(name).suffix().toLower();
+    return suffix == "jpg" || suffix == "jpeg" || suffix == "png";
+}
+
+/**
+ * @brief headerField
+ * @param header a tar header block
+ * @param offset the position of the field
+ * @param length the size of the field
+ * @return the NUL terminated content of the field
+ */
+static QByteArray headerField(const QByteArray &header, int offset, int length)
+{
+    QByteArray field = header.mid(offset, length);
+    int end = field.indexOf('\0');
+    return end < 0 ? field : field.left(end);
+}
+
+/**
+ * @brief memberPattern
+ * @return the pattern of a member path, capturing the archive, offset, size and name
+ */
+static QRegExp memberPattern()
+{
+    return QRegExp("^(.+\\.tar)#(\\d+)\\+(\\d+)/(.+)$");
+}
+
+/**
+ * @brief ImageSource::list
+ *
+ * Lists the images of an input, a directory, a tar archive or a list file.
+ *
+ * @param input the path of the input
+ * @return the absolute paths of the images, empty if none were found
+ */
+QStringList ImageSource::list(const QString &input)
+{
+    QFileInfo info(QDir().absoluteFilePath(input));
+    QStringList paths;
+    if(info.isDir()) {
+        QDir files(info.absoluteFilePath());
+        files.setFilter(QDir::NoDotAndDotDot | QDir::Files);
+        files.setNameFilters(QStringList() << "*.jpg" << "*.jpeg" << "*.png");
+        QDirIterator it(files);
+        while(it.hasNext()) {
+            paths << it.next();
+        }
+    } else if(info.suffix().toLower() == "tar") {
+        paths = archiveMembers(info.absoluteFilePath());
+    } else {
+        QFile file(info.absoluteFilePath());
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) return paths;
+        QDir directory = info.absoluteDir();
+        while(!file.atEnd()) {
+            QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if(line.isEmpty() || line.startsWith('#')) continue;
+            QString path = directory.absoluteFilePath(line);
+            if(QFileInfo(path).suffix().toLower() == "tar") paths << archiveMembers(path);
+            else paths << path;
+        }
+    }
+    return paths;
+}
+
+/**
+ * @brief ImageSource::archiveMembers
+ *
+ * Lists the image members of a tar archive, only the headers are read. Long names are
+ * taken from pax and GNU headers.
+ *
+ * @param archive the path of the archive
+ * @return the member paths, see open()
+ */
+QStringList ImageSource::archiveMembers(const QString &archive)
+{
+    QStringList members;
+    QFile file(archive);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qWarning().noquote() << "Unable to read:" << archive;
+        return members;
+    }
+    QString long_name; // of the next member, from a pax or GNU header
+    qint64 position = 0;
+    while(file.seek(position)) {
+        QByteArray header = file.read(TAR_BLOCK);
+        if(header.size() < TAR_BLOCK || header.count('\0') == TAR_BLOCK) break; // the end of the archive
+        bool ok = false;
+        qint64 size = headerField(header, 124, 12).trimmed().toLongLong(&ok, 8);
+        if(!ok) {
+            qWarning().noquote() << "Malformed tar header at" << position << "in:" << archive;
+            break;
+        }
+        qint64 content = position + TAR_BLOCK;
+        char type = header[156];
+        if(type == 'x' || type == 'L') {
+            QByteArray data = file.read(size);
+            if(type == 'L') {
+                long_name = QString::fromUtf8(headerField(data, 0, data.size()));
+            } else {
+                // pax records "<length> <key>=<value>\n"
+                for(int record = 0; record < data.size();) {
+                    int space = data.indexOf(' ', record);
+                    int length = data.mid(record, space - record).toInt();
+                    if(space < 0 || length <= 0) break;
+                    QByteArray entry = data.mid(space + 1, length - (space - record) - 2);
+                    if(entry.startsWith("path=")) long_name = QString::fromUtf8(entry.mid(5));
+                    record += length;
+                }
+            }
+        } else if(type == '0' || type == '\0') {
+            QString name = long_name;
+            if(name.isEmpty()) {
+                name = QString::fromUtf8(headerField(header, 0, 100));
+                QByteArray prefix = headerField(header, 345, 155);
+                if(header.mid(257, 5) == "ustar" && !prefix.isEmpty()) name = QString::fromUtf8(prefix) + "/" + name;
+            }
+            if(isImageName(name))
+                members << archive + "#" + QString::number(content) + "+" + QString::number(size) + "/" + name;
+            long_name.clear();
+        } else if(type != 'g') {
+            long_name.clear();
+        }
+        position = content + (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+    }
+    return members;
+}
+
+/**
+ * @brief ImageSource::isMember
+ * @param path an image path
+ * @return true if the path addresses a member of a tar archive
+ */
+bool ImageSource::isMember(const QString &path)
+{
+    return memberPattern().exactMatch(path);
+}
+
+/**
+ * @brief ImageSource::open
+ *
+ * Opens an image for reading, a file is read as it is, the content of an archive member is
+ * read into memory with one seek.
+ *
+ * @param path an image file path or a member path of archiveMembers()
+ * @return the open device, owned by the caller, or a closed device if it can not be read
+ */
+QIODevice *ImageSource::open(const QString &path)
+{
+    QRegExp member = memberPattern();
+    if(!member.exactMatch(path)) {
+        QFile *file = new QFile(path);
+        file->open(QIODevice::ReadOnly);
+        return file;
+    }
+    QBuffer *buffer = new QBuffer;
+    QFile archive(member.cap(1));
+    qint64 size = member.cap(3).toLongLong();
+    if(archive.open(QIODevice::ReadOnly) && archive.seek(member.cap(2).toLongLong())) {
+        QByteArray content = archive.read(size);
+        if(content.size() == size) {
+            buffer->setData(content);
+            buffer->open(QIODevice::ReadOnly);
+        }
+    }
+    return buffer;
+}
+
+/**
+ * @brief ImageSource::decodeScaled
+ *
+ * Decodes an encoded image read from a device, e.g. an image opened by open() or a frame of
+ * MorphStream::run(), and scales it to the target size. Oversized JPEG images are decoded
+ * at 1/2, 1/4 or 1/8 of their size in the DCT domain, the largest reduction which is not
+ * smaller than the target, the exact target size is reached by a smooth resample.
+ *
+ * @param device an open device positioned at the encoded image
+ * @param size the target size, invalid to keep the size of the image
+ * @return the scaled image, null if the content could not be decoded
+ */
+QImage ImageSource::decodeScaled(QIODevice *device, const QSize &size)
+{
+    QImageReader reader(device);
+    QSize original = reader.size();
+    if(reader.format() == "jpeg" && original.isValid() && size.isValid()) {
+        int factor = 1;
+        while(factor < 8 && original.width() / (factor * 2) >= size.width()
+              && original.height() / (factor * 2) >= size.height()) {
+            factor *= 2;
+        }
+        if(factor > 1) {
+            // libjpeg rounds the reduced dimensions up, requesting them avoids a resample in the reader
+            reader.setScaledSize(QSize((original.width() + factor - 1) / factor,
+                                       (original.height() + factor - 1) / factor));
+        }
+    }
+    QImage image = reader.read();
+    if(image.isNull() || !size.isValid() || image.size() == size) return image;
+    return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+}
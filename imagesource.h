@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QImage>
+#include <QIODevice>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+namespace fmg {
+/**
+ * @brief The ImageSource struct
+ *
+ * The inputs of a job, besides a directory of image files:
+ *
+ *   - a tar archive, e.g. a shard of a dataset, whose *.jpg, *.jpeg and *.png members are
+ *     read in place, nothing is extracted to disk
+ *   - a list file of image paths, one per line, relative to the list, lines naming a tar
+ *     archive add its members, empty lines and lines starting with # are skipped
+ *
+ * A member of an archive is addressed by the path <archive>.tar#<offset>+<size>/<name>,
+ * offset and size locating the content within the archive, such that it is read with one
+ * seek, see open(). Listing an archive only reads its headers, the content is read when
+ * the image is decoded. Every reader of the input images opens them through open(), and
+ * decodes them through decodeScaled().
+ */
+struct ImageSource {
+    static QStringList list(const QString &input);
+    static QStringList archiveMembers(const QString &archive);
+    static bool isMember(const QString &path);
+    static QIODevice *open(const QString &path);
+    static QImage decodeScaled(QIODevice *device, const QSize &size);
+};
+}
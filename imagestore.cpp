@@ -0,0 +1,242 @@
+#include "imagestore.h"
+
+#include "pixelcache.h"
+
+#include <algorithm>
+
+#include <QDebug>
+
+namespace fmg {
+/**
+ * @brief ImageStore::ImageStore
+ *
+ * The ImageStore ctor, the budget is unlimited and the PixelCache disabled.
+ *
+ */
+ImageStore::ImageStore() :
+    m_budget(0) {}
+
+/**
+ * @brief ImageStore::setContext
+ * @param context the job defining the resolution the images are decoded at
+ */
+void ImageStore::setContext(const fmg::MorphContext &context)
+{
+    m_context = context;
+}
+
+/**
+ * @brief ImageStore::setBudget
+ *
+ * Limits the decoded pixels kept resident, images beyond the budget are released by the
+ * next call to image().
+ *
+ * @param bytes the budget in bytes, 0 for unlimited
+ */
+void ImageStore::setBudget(qint64 bytes)
+{
+    m_budget = std::max<qint64>(bytes, 0);
+}
+
+/**
+ * @brief ImageStore::budget
+ * @return the budget in bytes, 0 if unlimited
+ */
+qint64 ImageStore::budget() const
+{
+    return m_budget;
+}
+
+/**
+ * @brief ImageStore::setCacheDirectory
+ * @param directory the PixelCache directory, empty to disable the cache
+ */
+void ImageStore::setCacheDirectory(const QString &directory)
+{
+    m_cache_directory = directory;
+}
+
+/**
+ * @brief ImageStore::add
+ *
+ * Adds an image without decoding it, see image().
+ *
+ * @param path the image file path
+ * @param digest the content digest of the file, required by the PixelCache
+ * @return the index of the image
+ */
+int ImageStore::add(const QString &path, const QByteArray &digest)
+{
+    FaceImage image;
+    image.setImagePath(path);
+    m_images.push_back(image);
+    m_paths << path;
+    m_digests.push_back(digest);
+    return (int)m_images.size() - 1;
+}
+
+/**
+ * @brief ImageStore::removeLast
+ *
+ * Removes the image added last, e.g. if it turned out to be unreadable.
+ *
+ */
+void ImageStore::removeLast()
+{
+    if(m_images.empty()) return;
+    m_lru.removeOne((int)m_images.size() - 1);
+    m_images.pop_back();
+    m_paths.removeLast();
+    m_digests.pop_back();
+}
+
+/**
+ * @brief ImageStore::image
+ *
+ * Returns a resident image, the image is decoded if it was released or never loaded, and
+ * the least recently used images are released until the budget is met. The image passed
+ * before is kept resident as well, hence two images are always available at once.
+ *
+ * @param index the index of the image
+ * @return the resident image, nullptr if it could not be loaded
+ */
+FaceImage *ImageStore::image(int index)
+{
+    if(index < 0 || index >= (int)m_images.size()) return nullptr;
+    if(!m_images[index].hasImage() && !load(index)) return nullptr;
+    m_lru.removeOne(index);
+    m_lru.append(index);
+    evict(2);
+    return &m_images[index];
+}
+
+/**
+ * @brief ImageStore::entry
+ * @param index the index of the image
+ * @return the image, its pixels are not loaded if it is not resident
+ */
+FaceImage &ImageStore::entry(int index)
+{
+    return m_images[index];
+}
+
+/**
+ * @brief ImageStore::path
+ * @param index the index of the image
+ * @return the image file path
+ */
+const QString &ImageStore::path(int index) const
+{
+    return m_paths[index];
+}
+
+/**
+ * @brief ImageStore::digest
+ * @param index the index of the image
+ * @return the content digest passed to add()
+ */
+const QByteArray &ImageStore::digest(int index) const
+{
+    return m_digests[index];
+}
+
+/**
+ * @brief ImageStore::size
+ * @return the amount of images added
+ */
+int ImageStore::size() const
+{
+    return (int)m_images.size();
+}
+
+/**
+ * @brief ImageStore::blockSize
+ *
+ * The amount of images per block of the pair schedule, such that two blocks fit in the
+ * budget. A decoded image occupies 3 bytes per pixel, its RGB source, the derived images
+ * are only created on demand.
+ *
+ * @return the images per block, at least 1, all images if the budget is unlimited
+ */
+int ImageStore::blockSize() const
+{
+    if(m_budget == 0 || !m_context.isValid()) return std::max(size(), 1);
+    qint64 image_bytes = 3 * (qint64)m_context.img_width * m_context.img_height;
+    return (int)std::max<qint64>(m_budget / image_bytes / 2, 1);
+}
+
+/**
+ * @brief ImageStore::clear
+ *
+ * Removes every image, the context, budget and cache directory are kept.
+ *
+ */
+void ImageStore::clear()
+{
+    m_images.clear();
+    m_paths.clear();
+    m_digests.clear();
+    m_lru.clear();
+}
+
+/**
+ * @brief ImageStore::load
+ *
+ * A private convenience method decoding an image at the resolution of the context, through
+ * the PixelCache if a cache directory is set. A decoded image missing from the cache is
+ * stored, a failure to store it only costs the next run a decode. The landmarks of the
+ * image are kept.
+ *
+ * @param index the index of the image
+ * @return true if the image was loaded
+ */
+bool ImageStore::load(int index)
+{
+    FaceImage &image = m_images[index];
+    const QString &path = m_paths[index];
+    const QByteArray &digest = m_digests[index];
+    bool loaded = false;
+    if(m_cache_directory.isEmpty() || digest.isEmpty()) {
+        loaded = image.setImageSource(path, m_context);
+    } else {
+        QSize size(m_context.img_width, m_context.img_height);
+        QImage cached = PixelCache::load(m_cache_directory, digest, size);
+        if(!cached.isNull()) {
+            loaded = image.setImageSource(path, cached, m_context);
+        } else {
+            loaded = image.setImageSource(path, m_context);
+            if(loaded && !PixelCache::store(m_cache_directory, digest, image.getSource()))
+                qWarning() << "Unable to cache the decoded image:" << path;
+        }
+    }
+    return loaded;
+}
+
+/**
+ * @brief ImageStore::evict
+ *
+ * A private convenience method meeting the budget, the derived images of the least
+ * recently used images are released first, since they are cheap to derive again, then
+ * the least recently used images themselves. The resident bytes are counted here, the
+ * derived images are created by the users of the images.
+ *
+ * @param keep the amount of most recently used images which are never released
+ */
+void ImageStore::evict(int keep)
+{
+    if(m_budget == 0) return;
+    qint64 resident = 0;
+    for(int index : m_lru) resident += m_images[index].imageBytes();
+    for(int i = 0; resident > m_budget && i < m_lru.size() - keep; ++i) {
+        FaceImage &image = m_images[m_lru[i]];
+        qint64 before = image.imageBytes();
+        image.releaseDerivedImages();
+        resident -= before - image.imageBytes();
+    }
+    while(resident > m_budget && m_lru.size() > keep) {
+        FaceImage &image = m_images[m_lru.takeFirst()];
+        resident -= image.imageBytes();
+        image.releaseImages();
+    }
+}
+}
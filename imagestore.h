@@ -0,0 +1,65 @@
+#pragma once
+
+#include "faceimage.h"
+#include "morphcontext.h"
+
+#include <vector>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace fmg {
+/**
+ * @brief The ImageStore class
+ *
+ * The images of a job, decoded on demand at the resolution of the job. Every image keeps
+ * its path, title and landmarks, while the decoded pixels of at most budget() bytes are
+ * resident. Under pressure the derived grayscale images and landmark overlays are dropped
+ * first, then the least recently used images are released and decoded again, or mapped
+ * from the PixelCache, when they are needed later. A budget of 0 keeps every decoded
+ * image resident.
+ *
+ * The pairs of images should be visited in blocks of blockSize() images, see MorphEngine,
+ * such that the images of two blocks stay resident while every pair between them is
+ * processed.
+ *
+ * Ownership: the pointers returned by image() and entry() are invalidated by add() and
+ * clear(), the pixels of an image may be released by a later call to image().
+ */
+class ImageStore
+{
+public:
+    ImageStore();
+
+    void setContext(const fmg::MorphContext &context);
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+    void setCacheDirectory(const QString &directory);
+
+    int add(const QString &path, const QByteArray &digest = QByteArray());
+    void removeLast();
+    FaceImage *image(int index);
+    FaceImage &entry(int index);
+    const QString &path(int index) const;
+    const QByteArray &digest(int index) const;
+    int size() const;
+    int blockSize() const;
+    void clear();
+
+private:
+    bool load(int index);
+    void evict(int keep);
+
+private:
+    fmg::MorphContext m_context;
+    qint64 m_budget;
+    QString m_cache_directory;
+
+    std::vector<FaceImage> m_images;
+    QStringList m_paths;
+    std::vector<QByteArray> m_digests;
+    QList<int> m_lru; // the resident images, the most recently used last
+};
+}
@@ -2,18 +2,25 @@
 #include <QApplication>
 
 #include "commandlinemorphing.h"
-#include "globals.h"
 
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 
+#include <cstring>
 #include <memory>
 
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
-    QApplication::setApplicationName("fmg-qt");
-    QApplication::setApplicationVersion("1.0");
+    // the widget stack is only initialized for the graphical user interface, batch morphing
+    // runs under a QCoreApplication and does not require a display
+    bool gui_requested = argc == 1;
+    for(int i = 1; i < argc; ++i) {
+        if(std::strcmp(argv[i], "--gui") == 0) gui_requested = true;
+    }
+    std::unique_ptr<QCoreApplication> app(gui_requested ? new QApplication(argc, argv)
+                                                        : new QCoreApplication(argc, argv));
+    QCoreApplication::setApplicationName("fmg-qt");
+    QCoreApplication::setApplicationVersion("1.0");
     std::unique_ptr<MainWindow> gui;
 
     QCommandLineParser parser;
@@ -27,33 +34,15 @@ int main(int argc, char *argv[])
                                  "Graphical User Interface");
     parser.addOption(guiOption);
 
-    QCommandLineOption inputDirectoryOption(QStringList() << "i" << "input-directory",
-                                            "Specifies the directory in which the images to be morphed resides",
-                                            "directory");
-    parser.addOption(inputDirectoryOption);
-
-    QCommandLineOption outputDirectoryOption(QStringList() << "o" << "output-directory",
-                                             "Specifies the target directory for the morphed results",
-                                             "directory");
-    parser.addOption(outputDirectoryOption);
-
-    QCommandLineOption settingsOption(QStringList() << "s" << "settings",
-                                      "Specifies the json-formatted settings file",
-                                      "file");
-    parser.addOption(settingsOption);
+    CommandLineMorphing::addOptions(parser);
 
-    parser.process(app);
-    if(parser.isSet(guiOption) || argc == 1) {
-        fmg::Globals::gui = true;
+    parser.process(*app);
+    if(gui_requested) {
         gui = std::make_unique<MainWindow>(nullptr);
         gui->setStyleSheet("QMainWindow {background: 'white';}");
         gui->show();
-    } else if(parser.isSet(inputDirectoryOption) && parser.isSet(outputDirectoryOption) && !parser.isSet(settingsOption)) { // default morphing procedure
-        CommandLineMorphing(parser.value(inputDirectoryOption), parser.value(outputDirectoryOption));
-    } else if(parser.isSet(inputDirectoryOption) && parser.isSet(outputDirectoryOption) && parser.isSet(settingsOption)) { // settings procedure
-        CommandLineMorphing(parser.value(inputDirectoryOption), parser.value(outputDirectoryOption), parser.value(settingsOption));
     } else {
-        parser.showHelp(1);
+        return CommandLineMorphing::run(parser);
     }
-    return app.exec();
+    return app->exec();
 }
@@ -0,0 +1,138 @@
+#include "morphbatchrunner.h"
+
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * @brief MorphBatchRunner::MorphBatchRunner
+ *
+ * The MorphBatchRunner ctor, the engine is a child of the runner, hence it follows the
+ * runner into its thread.
+ *
+ * @param parent the Qt parent
+ */
+MorphBatchRunner::MorphBatchRunner(QObject *parent) :
+    QObject(parent),
+    m_engine(this)
+{
+    qRegisterMetaType<QVector<QPoint>>("QVector<QPoint>");
+    connect(&m_engine, SIGNAL(message(QString)),
+            this, SIGNAL(message(QString)));
+
+    connect(&m_engine, SIGNAL(resultReady(MorphResult)),
+            this, SIGNAL(resultReady(MorphResult)));
+}
+
+/**
+ * @brief MorphBatchRunner::cancel
+ *
+ * Requests the running batch to stop after the current pair, thread-safe.
+ *
+ */
+void MorphBatchRunner::cancel()
+{
+    m_engine.cancel();
+}
+
+/**
+ * @brief MorphBatchRunner::prepareJob
+ *
+ * Prepares a job of which only batches are run by this runner, see runBatch(). None of the
+ * images are loaded yet and the manifest is left to the coordinator of the job, hence
+ * several runners, in any process, may work on the job at once.
+ *
+ * An example job:
+ * {
+ *   "images": ["/absolute/image/one.jpg", "/absolute/image/two.jpg", ...],
+ *   "output": "/absolute/output/directory",
+ *   "resume": false,
+ *   "cache": "/absolute/cache/directory",
+ *   "settings": { ..., "resolution": [width, height] }
+ * }
+ *
+ * the settings must contain the resolution of the job, such that every engine scales the
+ * images alike, the cache directory is optional. A failure is reported through finished().
+ *
+ * @param job the json job description
+ */
+void MorphBatchRunner::prepareJob(const QJsonObject &job)
+{
+    m_engine.clear();
+    m_engine.resetSettings();
+    m_engine.setResume(job["resume"].toBool());
+    m_engine.setCacheDirectory(job["cache"].toString());
+    m_engine.setArchiveOutput(0); // the coordinator records files only
+    m_engine.setManifestOutput(false);
+    m_output_directory = job["output"].toString();
+    QStringList paths;
+    for(const QJsonValue &path : job["images"].toArray()) paths << path.toString();
+    bool ok = m_engine.configure(job["settings"].toObject());
+    ok = ok && m_engine.registerImages(paths);
+    if(!ok) emit finished(false, m_engine.errorString());
+}
+
+/**
+ * @brief MorphBatchRunner::runBatch
+ *
+ * Runs a batch of the job prepared by prepareJob(), the images of the batch are loaded
+ * on demand. A batch either detects the landmarks of images, reported by landmarksReady(),
+ * or morphs ordered pairs of images, reported by resultReady(), given the landmarks
+ * detected before, possibly by another engine. The indices refer to the images of the job.
+ *
+ * An example of each batch:
+ * {"id": 1, "detect": [0, 1, 2]}
+ * {"id": 2, "pairs": [[0, 1], [1, 0]], "landmarks": {"0": [x0, y0, x1, y1, ...], "1": [...]}}
+ *
+ * batchFinished() is emitted when the batch is done.
+ *
+ * @param batch the json batch description
+ */
+void MorphBatchRunner::runBatch(const QJsonObject &batch)
+{
+    m_engine.resetRun();
+    int id = batch["id"].toInt();
+    for(const QJsonValue &value : batch["detect"].toArray()) {
+        if(m_engine.isCanceled()) break;
+        std::vector<QPoint> landmarks;
+        if(!m_engine.detectLandmarks(value.toInt(), landmarks)) {
+            emit batchFinished(id, false, m_engine.errorString());
+            return;
+        }
+        emit landmarksReady(value.toInt(), QVector<QPoint>::fromStdVector(landmarks));
+    }
+
+    QJsonObject landmarks = batch["landmarks"].toObject();
+    for(auto it = landmarks.constBegin(); it != landmarks.constEnd(); ++it) {
+        QJsonArray coordinates = it.value().toArray();
+        std::vector<QPoint> points;
+        for(int i = 0; i + 1 < coordinates.size(); i += 2)
+            points.push_back(QPoint(coordinates[i].toInt(), coordinates[i + 1].toInt()));
+        if(!m_engine.setLandmarks(it.key().toInt(), points)) {
+            emit batchFinished(id, false, m_engine.errorString());
+            return;
+        }
+    }
+
+    QJsonArray pairs = batch["pairs"].toArray();
+    bool ok = pairs.isEmpty() || m_engine.beginRun(m_output_directory);
+    for(const QJsonValue &value : pairs) {
+        if(!ok || m_engine.isCanceled()) break;
+        int one = m_engine.imagePosition(value.toArray()[0].toInt());
+        int two = m_engine.imagePosition(value.toArray()[1].toInt());
+        if(one < 0 || two < 0) {
+            m_engine.failRun(m_engine.error(), m_engine.errorString());
+            emit batchFinished(id, false, m_engine.errorString());
+            return;
+        }
+        m_engine.morphPair(one, two);
+    }
+    // the batch is complete once every result is saved, a result which could not be saved
+    // is reported by its own MorphResult
+    if(m_engine.isCanceled()) ok = m_engine.failRun(MorphEngine::CANCELED, "Canceled");
+    else if(!ok) m_engine.failRun(m_engine.error(), m_engine.errorString());
+    else m_engine.endRun(true);
+    emit batchFinished(id, ok, ok ? QString() : m_engine.errorString());
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QObject>
+
+#include "morphengine.h"
+
+#include <QJsonObject>
+#include <QPoint>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The MorphBatchRunner class
+ *
+ * Runs the batches of a distributed job on its own MorphEngine, see MorphWorker and
+ * MorphCoordinator. The job is prepared once by prepareJob(), the batches then either
+ * detect the landmarks of images or morph pairs of images, see runBatch(). The runner and
+ * its engine are meant to live in a separate thread, the slots are invoked queued.
+ */
+class MorphBatchRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphBatchRunner(QObject *parent = nullptr);
+
+    void cancel();
+
+signals:
+    void message(const QString &text);
+    void resultReady(const MorphResult &result);
+    void landmarksReady(int image, const QVector<QPoint> &landmarks);
+    void batchFinished(int batch, bool ok, const QString &error);
+    void finished(bool ok, const QString &error);
+
+public slots:
+    void prepareJob(const QJsonObject &job);
+    void runBatch(const QJsonObject &batch);
+
+private:
+    MorphEngine m_engine;
+    QString m_output_directory;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace fmg {
+/**
+ * @brief The MorphContext struct
+ *
+ * The state of one morphing job which is read by the image loading and morphing routines,
+ * i.e. the resolution every image of the job is scaled to. A context is passed explicitly
+ * to FaceImage and ImageProcessor, hence jobs with different resolutions may run
+ * concurrently in one process.
+ */
+struct MorphContext {
+    int img_width = 0;
+    int img_height = 0;
+
+    bool isValid() const { return img_width > 0 && img_height > 0; }
+};
+}
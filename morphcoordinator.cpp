@@ -0,0 +1,381 @@
+#include "morphcoordinator.h"
+
+#include "imageprobe.h"
+#include "imagesource.h"
+#include "morphengine.h"
+#include "morphservice.h"
+
+#include <algorithm>
+#include <QDateTime>
+#include <QDir>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#define DETECT_BATCH 8 // images per landmark batch
+#define PAIR_BATCH 32 // ordered pairs per morph batch
+#define HEARTBEAT_TIMEOUT 30000 // ms without a frame before a worker is considered dead
+
+/**
+ * @brief MorphCoordinator::MorphCoordinator
+ * @param parent the Qt parent
+ */
+MorphCoordinator::MorphCoordinator(QObject *parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this)),
+    m_next_id(0),
+    m_detecting(true),
+    m_done(false),
+    m_results(0),
+    m_failures(0)
+{
+    connect(m_server, SIGNAL(newConnection()),
+            this, SLOT(newConnection()));
+
+    m_heartbeat_timer.setInterval(HEARTBEAT_TIMEOUT / 2);
+    connect(&m_heartbeat_timer, SIGNAL(timeout()),
+            this, SLOT(checkHeartbeats()));
+}
+
+/**
+ * @brief MorphCoordinator::setJob
+ *
+ * Prepares the job, the images of the input directory are listed and the resolution of the
+ * job is determined from the image headers, if it was not configured. The landmark batches
+ * are queued.
+ *
+ * @param input_dir the directory, tar archive or list file of the input images, see
+ * fmg::ImageSource, the same path on every worker
+ * @param output_dir the output directory, the same path on every worker
+ * @param settings the json settings, see MorphEngine::configure
+ * @param resume true to skip the outputs recorded in the manifest, see MorphEngine::setResume
+ * @return true if the job is ready to be served
+ */
+bool MorphCoordinator::setJob(const QString &input_dir, const QString &output_dir,
+                              const QJsonObject &settings, bool resume)
+{
+    m_paths = fmg::ImageSource::list(input_dir);
+    m_paths.sort();
+    if(m_paths.size() < 2) {
+        m_error_string = "At least two images are required in: " + QDir(input_dir).absolutePath();
+        return false;
+    }
+
+    QJsonObject job_settings = settings;
+    QJsonArray resolution = settings["resolution"].toArray();
+    if(resolution.size() != 2 || resolution[0].toInt(-1) == -1 || resolution[1].toInt(-1) == -1) {
+        QString unreadable;
+        QSize minimum = fmg::ImageProbe::minimumSize(m_paths, &unreadable);
+        if(!minimum.isValid()) {
+            m_error_string = "Failed to read: " + unreadable;
+            return false;
+        }
+        job_settings["resolution"] = QJsonArray{minimum.width(), minimum.height()};
+    }
+
+    QString output_directory = QDir(output_dir).absolutePath();
+    m_manifest.close();
+    m_manifest.setFileName(output_directory + "/manifest.jsonl");
+    if(!QDir().mkpath(output_directory) || !m_manifest.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        m_error_string = "Unable to write to the output directory: " + output_directory;
+        return false;
+    }
+
+    QJsonArray images;
+    for(const QString &path : m_paths) images.append(path);
+    m_job = QJsonObject{{"type", "job"},
+                        {"images", images},
+                        {"output", output_directory},
+                        {"resume", resume},
+                        {"settings", job_settings}};
+
+    m_landmarks.clear();
+    m_pending.clear();
+    m_assigned.clear();
+    m_detecting = true;
+    m_done = false;
+    m_results = 0;
+    m_failures = 0;
+    for(int first = 0; first < m_paths.size(); first += DETECT_BATCH) {
+        Batch batch{m_next_id++, QJsonArray(), QJsonArray()};
+        for(int i = first; i < std::min(first + DETECT_BATCH, m_paths.size()); ++i) batch.detect.append(i);
+        m_pending.append(batch);
+    }
+    emit message("Job of " + QString::number(m_paths.size()) + " images, "
+                 + QString::number(m_pending.size()) + " landmark batches queued");
+    return true;
+}
+
+/**
+ * @brief MorphCoordinator::listen
+ * @param port the TCP port
+ * @param address the address to listen on, any address by default
+ * @return true if the coordinator is listening
+ */
+bool MorphCoordinator::listen(quint16 port, const QHostAddress &address)
+{
+    if(!m_server->listen(address, port)) {
+        m_error_string = m_server->errorString();
+        return false;
+    }
+    m_heartbeat_timer.start();
+    emit message("Coordinator listening on port: " + QString::number(m_server->serverPort()));
+    return true;
+}
+
+/**
+ * @brief MorphCoordinator::errorString
+ * @return a description of the last error
+ */
+QString MorphCoordinator::errorString() const
+{
+    return m_error_string;
+}
+
+/**
+ * @brief MorphCoordinator::newConnection
+ *
+ * A private SLOT invoked when a worker connects.
+ *
+ */
+void MorphCoordinator::newConnection()
+{
+    while(QTcpSocket *worker = m_server->nextPendingConnection()) {
+        m_workers.insert(worker, Worker{QByteArray(), QDateTime::currentMSecsSinceEpoch(), QSet<int>()});
+        connect(worker, SIGNAL(readyRead()),
+                this, SLOT(readRequests()));
+        connect(worker, SIGNAL(disconnected()),
+                this, SLOT(workerDisconnected()));
+        emit message("Worker connected: " + worker->peerAddress().toString());
+    }
+}
+
+/**
+ * @brief MorphCoordinator::readRequests
+ *
+ * A private SLOT invoked when a worker sent data, every frame counts as a heartbeat. A
+ * worker sending a malformed frame is disconnected.
+ *
+ */
+void MorphCoordinator::readRequests()
+{
+    QTcpSocket *worker = qobject_cast<QTcpSocket*>(sender());
+    if(!worker || !m_workers.contains(worker)) return;
+    m_workers[worker].last_seen = QDateTime::currentMSecsSinceEpoch();
+    m_workers[worker].buffer += worker->readAll();
+    QJsonObject request;
+    bool malformed = false;
+    while(m_workers.contains(worker) && MorphService::nextFrame(m_workers[worker].buffer, request, &malformed)) {
+        dispatch(worker, request);
+    }
+    if(malformed) {
+        emit message("Malformed request, disconnecting: " + worker->peerAddress().toString());
+        worker->abort();
+    }
+}
+
+/**
+ * @brief MorphCoordinator::workerDisconnected
+ *
+ * A private SLOT invoked when a worker disconnects, its batches are requeued.
+ *
+ */
+void MorphCoordinator::workerDisconnected()
+{
+    QTcpSocket *worker = qobject_cast<QTcpSocket*>(sender());
+    if(!worker || !m_workers.contains(worker)) return;
+    requeue(worker);
+    m_workers.remove(worker);
+    worker->deleteLater();
+}
+
+/**
+ * @brief MorphCoordinator::checkHeartbeats
+ *
+ * A private SLOT disconnecting the workers which did not send a frame for
+ * HEARTBEAT_TIMEOUT ms, their batches are requeued.
+ *
+ */
+void MorphCoordinator::checkHeartbeats()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for(QTcpSocket *worker : m_workers.keys()) {
+        if(!m_workers.contains(worker)) continue; // removed by an earlier abort()
+        if(now - m_workers[worker].last_seen < HEARTBEAT_TIMEOUT) continue;
+        emit message("Worker timed out: " + worker->peerAddress().toString());
+        requeue(worker);
+        worker->abort();
+    }
+}
+
+/**
+ * @brief MorphCoordinator::dispatch
+ *
+ * A private convenience method handling one request of a worker.
+ *
+ * @param worker the requesting worker
+ * @param request the json request
+ */
+void MorphCoordinator::dispatch(QTcpSocket *worker, const QJsonObject &request)
+{
+    QString type = request["type"].toString();
+    if(type == "hello") {
+        send(worker, m_job);
+    } else if(type == "request") {
+        assignBatch(worker);
+    } else if(type == "landmarks") {
+        QJsonArray points = request["points"].toArray();
+        int image = request["image"].toInt();
+        if(!m_landmarks.contains(image) && points.isEmpty())
+            emit message("No face detected: " + m_paths.value(image));
+        m_landmarks.insert(image, points);
+    } else if(type == "result") {
+        MorphResult result;
+        result.reference_one = request["one"].toString();
+        result.reference_two = request["two"].toString();
+        result.path = request["path"].toString();
+        result.error = request["error"].toString();
+        result.digest = request["sha1"].toString();
+        ++m_results;
+        if(!result.error.isEmpty()) {
+            ++m_failures;
+            emit message(result.error);
+        } else {
+            m_manifest.write(MorphEngine::manifestEntry(result) + "\n");
+            m_manifest.flush();
+        }
+    } else if(type == "complete") {
+        int id = request["id"].toInt();
+        if(!m_workers[worker].batches.remove(id)) return; // requeued meanwhile
+        m_assigned.remove(id);
+        if(!request["ok"].toBool(true)) {
+            ++m_failures;
+            emit message("Batch failed: " + request["error"].toString());
+        }
+        advance();
+    }
+}
+
+/**
+ * @brief MorphCoordinator::advance
+ *
+ * A private convenience method moving the job to the morph phase once every landmark batch
+ * is complete, and finishing it once every morph batch is complete, the connected workers
+ * are told that the job is done.
+ *
+ */
+void MorphCoordinator::advance()
+{
+    if(!m_pending.isEmpty() || !m_assigned.isEmpty() || m_done) return;
+    if(m_detecting) {
+        m_detecting = false;
+        enqueuePairs();
+        if(!m_pending.isEmpty()) return;
+    }
+    m_done = true;
+    for(QTcpSocket *worker : m_workers.keys()) {
+        send(worker, QJsonObject{{"type", "done"}});
+        worker->flush();
+    }
+    emit message("Job done, " + QString::number(m_results) + " results, "
+                 + QString::number(m_failures) + " failures");
+    emit finished(m_failures == 0);
+}
+
+/**
+ * @brief MorphCoordinator::assignBatch
+ *
+ * A private convenience method answering a batch request. A morph batch carries the
+ * published landmarks of its images. A worker is told to wait while the last batches of
+ * the landmark phase are still running.
+ *
+ * @param worker the requesting worker
+ */
+void MorphCoordinator::assignBatch(QTcpSocket *worker)
+{
+    if(m_done) {
+        send(worker, QJsonObject{{"type", "done"}});
+        return;
+    }
+    if(m_pending.isEmpty()) {
+        send(worker, QJsonObject{{"type", "wait"}});
+        return;
+    }
+    Batch batch = m_pending.takeFirst();
+    QJsonObject frame{{"type", "batch"}, {"id", batch.id}};
+    if(!batch.detect.isEmpty()) frame["detect"] = batch.detect;
+    if(!batch.pairs.isEmpty()) {
+        QJsonObject landmarks;
+        for(const QJsonValue &pair : batch.pairs) {
+            for(const QJsonValue &image : pair.toArray())
+                landmarks[QString::number(image.toInt())] = m_landmarks.value(image.toInt());
+        }
+        frame["pairs"] = batch.pairs;
+        frame["landmarks"] = landmarks;
+    }
+    m_assigned.insert(batch.id, batch);
+    m_workers[worker].batches.insert(batch.id);
+    send(worker, frame);
+}
+
+/**
+ * @brief MorphCoordinator::requeue
+ *
+ * A private convenience method returning the batches of a worker to the front of the queue,
+ * images whose landmarks were already published are not detected again.
+ *
+ * @param worker the worker
+ */
+void MorphCoordinator::requeue(QTcpSocket *worker)
+{
+    if(!m_workers.contains(worker)) return;
+    for(int id : m_workers[worker].batches) {
+        Batch batch = m_assigned.take(id);
+        QJsonArray detect;
+        for(const QJsonValue &image : batch.detect) {
+            if(!m_landmarks.contains(image.toInt())) detect.append(image);
+        }
+        batch.detect = detect;
+        if(batch.detect.isEmpty() && batch.pairs.isEmpty()) continue;
+        m_pending.prepend(batch);
+        emit message("Requeued batch: " + QString::number(id));
+    }
+    m_workers[worker].batches.clear();
+    advance();
+}
+
+/**
+ * @brief MorphCoordinator::enqueuePairs
+ *
+ * A private convenience method queuing the morph batches once every landmark is known,
+ * both orders of a pair are placed in the same batch and images without a face are left
+ * out.
+ *
+ */
+void MorphCoordinator::enqueuePairs()
+{
+    Batch batch{m_next_id++, QJsonArray(), QJsonArray()};
+    for(int one = 0; one < m_paths.size(); ++one) {
+        if(m_landmarks.value(one).isEmpty()) continue;
+        for(int two = one + 1; two < m_paths.size(); ++two) {
+            if(m_landmarks.value(two).isEmpty()) continue;
+            batch.pairs.append(QJsonArray{one, two});
+            batch.pairs.append(QJsonArray{two, one});
+            if(batch.pairs.size() >= PAIR_BATCH) {
+                m_pending.append(batch);
+                batch = Batch{m_next_id++, QJsonArray(), QJsonArray()};
+            }
+        }
+    }
+    if(!batch.pairs.isEmpty()) m_pending.append(batch);
+    emit message(QString::number(m_pending.size()) + " morph batches queued");
+}
+
+/**
+ * @brief MorphCoordinator::send
+ * @param worker the receiving worker
+ * @param object the json object to be sent
+ */
+void MorphCoordinator::send(QTcpSocket *worker, const QJsonObject &object)
+{
+    worker->write(MorphService::frame(object));
+}
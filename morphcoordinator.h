@@ -0,0 +1,99 @@
+#pragma once
+#include <QObject>
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QTcpServer;
+class QTcpSocket;
+/**
+ * @brief The MorphCoordinator class
+ *
+ * The coordinator of a distributed job. Worker processes, see MorphWorker, connect over
+ * TCP, on localhost or from other nodes sharing the input and output directories, and pull
+ * batches from a queue until the job is done. The frames are the ones of MorphService.
+ *
+ * The job runs in two phases, first the landmarks of every image are detected once, in
+ * batches of images, and published back to the coordinator. Then the pairs of images with
+ * a face are morphed in batches of pairs, each batch carrying the landmarks it needs, hence
+ * no image is detected twice across the workers. A slow worker simply pulls fewer batches.
+ *
+ * Worker requests:
+ *   {"type": "hello"}                 answered with the job, see MorphBatchRunner::prepareJob
+ *   {"type": "request"}               answered with a batch, "wait" or "done"
+ *   {"type": "heartbeat"}
+ *   {"type": "landmarks", "image": index, "points": [x0, y0, ...]}
+ *   {"type": "result", "one": path, "two": path, "path": path, "error": text, "sha1": digest}
+ *   {"type": "complete", "id": batch}
+ *
+ * The batches of a worker which disconnects or stops sending frames for HEARTBEAT_TIMEOUT
+ * ms are requeued. The coordinator appends the results to the manifest of the output
+ * directory.
+ */
+class MorphCoordinator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphCoordinator(QObject *parent = nullptr);
+
+    bool setJob(const QString &input_dir, const QString &output_dir, const QJsonObject &settings,
+                bool resume = false);
+    bool listen(quint16 port, const QHostAddress &address = QHostAddress::Any);
+    QString errorString() const;
+
+signals:
+    void message(const QString &text);
+    void finished(bool ok);
+
+private slots:
+    void newConnection();
+    void readRequests();
+    void workerDisconnected();
+    void checkHeartbeats();
+
+private:
+    struct Batch {
+        int id;
+        QJsonArray detect;
+        QJsonArray pairs;
+    };
+    struct Worker {
+        QByteArray buffer;
+        qint64 last_seen;
+        QSet<int> batches;
+    };
+
+    void dispatch(QTcpSocket *worker, const QJsonObject &request);
+    void assignBatch(QTcpSocket *worker);
+    void requeue(QTcpSocket *worker);
+    void advance();
+    void enqueuePairs();
+    void send(QTcpSocket *worker, const QJsonObject &object);
+
+private:
+    QTcpServer *m_server;
+    QTimer m_heartbeat_timer;
+    QString m_error_string;
+
+    QJsonObject m_job;
+    QStringList m_paths;
+    QFile m_manifest;
+
+    QHash<int, QJsonArray> m_landmarks; // the published landmarks, empty if no face
+    QList<Batch> m_pending;
+    QHash<int, Batch> m_assigned;
+    QHash<QTcpSocket*, Worker> m_workers;
+    int m_next_id;
+    bool m_detecting;
+    bool m_done;
+    int m_results;
+    int m_failures;
+};
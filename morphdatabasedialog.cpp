@@ -2,11 +2,12 @@
 #include <QDebug>
 
 #include "databasepreview.h"
-#include "globals.h"
 #include "console.h"
+#include "imageprobe.h"
 #include "imagecontainer.h"
 #include "labelledslidergroup.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <QProgressDialog>
@@ -26,6 +27,8 @@
 #include <QLabel>
 #include <QDir>
 
+#define DATABASE_MEMORY_BUDGET (512 * 1024 * 1024) // bytes of decoded images kept resident
+
 /**
  * @brief MorphDatabaseDialog::MorphDatabaseDialog
  *
@@ -43,8 +46,6 @@ MorphDatabaseDialog::MorphDatabaseDialog(QWidget *parent, ImageContainer *previe
     m_landmarks_detected(false),
     m_jpeg_format(true),
     m_layout(new QVBoxLayout(this)),
-    m_one(new ImageContainer),
-    m_two(new ImageContainer),
     m_preview_label(new QLabel("<u>Preview</u>", this)),
     m_in_dir_layout(new QHBoxLayout),
     m_out_dir_layout(new QHBoxLayout),
@@ -76,6 +77,7 @@ MorphDatabaseDialog::MorphDatabaseDialog(QWidget *parent, ImageContainer *previe
     m_b_create_database(new QPushButton("Create Database", this)),
     m_b_cancel(new QPushButton("Close", this))
 {
+    m_database.setBudget(DATABASE_MEMORY_BUDGET);
     if(preview != nullptr)
         m_preview->update(preview);
     setup();
@@ -90,8 +92,6 @@ MorphDatabaseDialog::MorphDatabaseDialog(QWidget *parent, ImageContainer *previe
  */
 MorphDatabaseDialog::~MorphDatabaseDialog()
 {
-    for(ImageContainer *img : m_database) delete img;
-    m_database.clear();
 }
 
 /**
@@ -227,6 +227,8 @@ void MorphDatabaseDialog::setupConnections()
 
     connect(m_cb_remove_bad_morphs, &QCheckBox::toggled,
             [&](){m_remove_bad_morphs = !m_remove_bad_morphs;});
+
+    connect(&m_image_processor, &ImageProcessor::message, &Console::appendToConsole);
 }
 
 /**
@@ -241,28 +243,32 @@ void MorphDatabaseDialog::createPreview()
 {
     QProgressDialog diag("Searching for a proper preview", "Abort", 0, m_database.size(), this);
     diag.setWindowModality(Qt::WindowModal);
-    for(auto it = m_database.begin(); it != m_database.end(); ++it) {
+    int one = -1;
+    for(int i = 0; i < m_database.size(); ++i) {
         QApplication::processEvents();
         diag.setValue(diag.value() + 1);
-        m_one = *it;
-        m_one->setLandmarks(m_image_processor.getFacialFeatures(m_one));
-        if(!m_one->hasBadLandmarks()) break;
+        FaceImage *img = m_database.image(i);
+        if(!img) continue;
+        img->setLandmarks(m_image_processor.getFacialFeatures(img));
+        m_one = *img; // the preview keeps its own references, the store may release them
+        one = i;
+        if(!m_one.hasBadLandmarks(m_context)) break;
     }
-    for(auto it = m_database.end() - 1; it != m_database.begin(); --it) {
+    for(int i = m_database.size() - 1; i > 0; --i) {
         QApplication::processEvents();
         diag.setValue(diag.value() + 1);
-        if(*it == m_one) continue;
-        m_two = *it;
-        m_two->setLandmarks(m_image_processor.getFacialFeatures(m_two));
-        if(!m_two->hasBadLandmarks()) break;
+        if(i == one) continue;
+        FaceImage *img = m_database.image(i);
+        if(!img) continue;
+        img->setLandmarks(m_image_processor.getFacialFeatures(img));
+        m_two = *img;
+        if(!m_two.hasBadLandmarks(m_context)) break;
     }
     diag.setValue(m_database.size());
-    if(!m_one->hasBadLandmarks() && !m_two->hasBadLandmarks())
-        m_image_processor.morphImages(m_one, m_two, m_preview, 0.5);
+    if(!m_one.hasBadLandmarks(m_context) && !m_two.hasBadLandmarks(m_context))
+        m_image_processor.morphImages(&m_one, &m_two, m_preview, 0.5, m_context);
     else {
-        if(fmg::Globals::gui) {
-            Console::appendToConsole("Unable to find a proper preview with the database provided.");
-        }
+        Console::appendToConsole("Unable to find a proper preview with the database provided.");
     }
 }
 
@@ -316,12 +322,7 @@ void MorphDatabaseDialog::m_browse_in_dir_pressed()
                                                                QFileDialog::ShowDirsOnly |
                                                                QFileDialog::DontResolveSymlinks);
     if(directory_path.isEmpty()) return;
-    if(!m_database.empty()) {
-        for(ImageContainer *img : m_database) {
-            delete img;
-        }
-        m_database.clear();
-    }
+    m_database.clear();
     m_input_directory = directory_path;
     m_in_dir_text->setText(m_input_directory);
     QDir directory(directory_path);
@@ -331,33 +332,23 @@ void MorphDatabaseDialog::m_browse_in_dir_pressed()
 
     QStringList image_paths;
 
-    std::vector<int> widths;
-    std::vector<int> heights;
-
     while(it.hasNext()) {
         image_paths << it.next();
-        QImage img(it.filePath());
-        widths.push_back(img.width());
-        heights.push_back(img.height());
     }
 
-    fmg::Globals::img_width = (int)(*std::min_element(widths.begin(), widths.end()));
-    fmg::Globals::img_height = (int)(*std::min_element(heights.begin(), heights.end()));
+    // only the headers are read here, the images are decoded once, when they are loaded
+    QSize minimum = fmg::ImageProbe::minimumSize(image_paths);
+    m_context.img_width = minimum.width();
+    m_context.img_height = minimum.height();
 
     if(image_paths.size() <= 2) return;
 
-    m_width_edit->setText(QString::number(fmg::Globals::img_width));
-    m_height_edit->setText(QString::number(fmg::Globals::img_height));
+    m_width_edit->setText(QString::number(m_context.img_width));
+    m_height_edit->setText(QString::number(m_context.img_height));
 
-    QProgressDialog diag("Loading files...", "Abort", 0, directory.count(), this);
-    diag.setWindowModality(Qt::WindowModal);
-    for(const auto &path : image_paths) {
-        QApplication::processEvents();
-        diag.setValue(diag.value() + 1);
-        ImageContainer *img = new ImageContainer(this);
-        img->setImageSource(path);
-        m_database.push_back(img);
-    }
+    // the images are decoded on demand, see fmg::ImageStore
+    m_database.setContext(m_context);
+    for(const auto &path : image_paths) m_database.add(path);
 
     createPreview();
 
@@ -434,39 +425,50 @@ void MorphDatabaseDialog::m_b_create_database_pressed()
         QProgressDialog landmarks_diag("Detecting Landmarks...", "Abort", 0, m_database.size(), this);
         landmarks_diag.setWindowModality(Qt::WindowModal);
         landmarks_diag.setValue(landmarks_diag.value() + 1);
-        for(ImageContainer *img : m_database) {
+        for(int i = 0; i < m_database.size(); ++i) {
             if(landmarks_diag.wasCanceled()) break;
             landmarks_diag.setValue(landmarks_diag.value() + 1);
-            if(img->hasLandmarks()) continue;
-            img->setLandmarks(m_image_processor.getFacialFeatures(img));
+            if(m_database.entry(i).hasLandmarks()) continue;
+            FaceImage *img = m_database.image(i);
+            if(img) img->setLandmarks(m_image_processor.getFacialFeatures(img));
         }
         if(!landmarks_diag.wasCanceled()) m_landmarks_detected = true;
     }
 
+    // the pairs are visited in blocks of images, every pair between two blocks is morphed
+    // while both blocks are resident in the store
+    int block = m_database.blockSize();
     QProgressDialog diag("Creating Morphs...", "Abort", 0, m_database.size(), this);
     diag.setWindowModality(Qt::WindowModal);
-    for(ImageContainer *one : m_database) {
-        QApplication::processEvents();
-        diag.setValue(diag.value() + 1);
-        if(one->hasBadLandmarks() && m_remove_bad_morphs) continue;
-        for(auto it = m_database.begin(); it != m_database.end(); ++it) {
-            if(diag.wasCanceled()) break;
-            if(*it == one) continue;
-            ImageContainer *two = *it;
-            if(two->hasBadLandmarks() && m_remove_bad_morphs) continue;
-            ImageContainer target;
-            m_image_processor.morphImages(one, two, &target,
-                                          m_sliders->getSliderValue(ALPHA));
-            QImage img = target.getSource();
-            applyFilters(img);
-            target.setImage(img);
-            QString format = m_jpeg_format ? ".jpg" : ".png";
-            if(m_grayscale) {
-                target.getGrayscaleSource().save(m_out_dir_text->text() + "/" + "g_" + target.getImageTitle() + target.getId() + format);
-            } else {
-                target.getTempSource().save(m_out_dir_text->text() + "/" + target.getImageTitle() + target.getId() + format);
+    for(int rows = 0; rows < m_database.size(); rows += block) {
+        int rows_end = std::min(rows + block, m_database.size());
+        for(int columns = 0; columns < m_database.size() && !diag.wasCanceled(); columns += block) {
+            int columns_end = std::min(columns + block, m_database.size());
+            QApplication::processEvents();
+            for(int i = rows; i < rows_end; ++i) {
+                if(m_database.entry(i).hasBadLandmarks(m_context) && m_remove_bad_morphs) continue;
+                for(int j = columns; j < columns_end; ++j) {
+                    if(diag.wasCanceled()) break;
+                    if(i == j) continue;
+                    if(m_database.entry(j).hasBadLandmarks(m_context) && m_remove_bad_morphs) continue;
+                    FaceImage *one = m_database.image(i);
+                    FaceImage *two = m_database.image(j);
+                    if(!one || !two) continue;
+                    FaceImage target;
+                    m_image_processor.morphImages(one, two, &target,
+                                                  m_sliders->getSliderValue(ALPHA),
+                                                  m_context, m_grayscale);
+                    QImage img = target.getSource();
+                    applyFilters(img);
+                    target.setImage(img);
+                    QString format = m_jpeg_format ? ".jpg" : ".png";
+                    // a grayscale morph is already a single channel image
+                    QString prefix = m_grayscale ? "g_" : "";
+                    target.getTempSource().save(m_out_dir_text->text() + "/" + prefix + target.getImageTitle() + target.getId() + format);
+                }
             }
         }
+        diag.setValue(rows_end);
     }
     diag.setValue(m_database.size());
     Console::appendToConsole("Succesfully created morph-database: " + m_out_dir_text->text());
@@ -490,8 +492,9 @@ void MorphDatabaseDialog::m_b_create_database_pressed()
  */
 void MorphDatabaseDialog::m_alpha_changed()
 {
-    m_image_processor.morphImages(m_one, m_two, m_preview,
-                                  m_sliders->getSliderValue(ALPHA));
+    m_image_processor.morphImages(&m_one, &m_two, m_preview,
+                                  m_sliders->getSliderValue(ALPHA),
+                                  m_context);
     m_slider_changed();
 }
 
@@ -2,6 +2,7 @@
 #include <QDialog>
 
 #include "imageprocessor.h"
+#include "imagestore.h"
 
 #include <vector>
 #include <QString>
@@ -67,9 +68,9 @@ private:
     };
 
     QVBoxLayout *m_layout;
-    ImageContainer *m_one;
+    FaceImage m_one;
     ImageContainer *m_preview;
-    ImageContainer *m_two;
+    FaceImage m_two;
     QLabel *m_preview_label;
 
     QHBoxLayout *m_in_dir_layout;
@@ -110,6 +111,7 @@ private:
     QPushButton *m_b_cancel;
 
     ImageProcessor m_image_processor;
+    fmg::MorphContext m_context;
 
-    std::vector<ImageContainer*> m_database;
+    fmg::ImageStore m_database;
 };
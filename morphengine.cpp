@@ -0,0 +1,1585 @@
+#include "morphengine.h"
+
+#include "imageprobe.h"
+#include "imagesource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QScopedPointer>
+#include <QDebug>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QBuffer>
+
+#define MANIFEST_NAME "manifest.jsonl"
+#define ARCHIVE_PREFIX "morphs"
+
+/**
+ * @brief MorphEngine::MorphEngine
+ *
+ * The MorphEngine ctor, the settings are initialized with the default values documented
+ * in configure(), the shared shape predictor is acquired by the owned ImageProcessor.
+ *
+ * @param parent the Qt parent
+ */
+MorphEngine::MorphEngine(QObject *parent) :
+    QObject(parent),
+    m_image_count(0),
+    m_shard_index(0),
+    m_shard_count(1),
+    m_shard_blocks(1),
+    m_morph_nsecs(0),
+    m_morphed(0),
+    m_processed(0),
+    m_resume(false),
+    m_write_manifest(true),
+    m_archive_size(0),
+    m_ring_slots(0),
+    m_ring_timeout(0),
+    m_canceled(false),
+    m_error(NONE)
+{
+    qRegisterMetaType<MorphResult>("MorphResult");
+    resetSettings();
+    connect(&m_image_processor, SIGNAL(message(QString)),
+            this, SIGNAL(message(QString)));
+}
+
+/**
+ * @brief MorphEngine::runJob
+ *
+ * Runs a complete job described by a json object, the settings of a previous job are
+ * reset to their defaults, the loaded shape predictor and the caches are kept.
+ *
+ * An example job:
+ * {
+ *   "input": "/absolute/input/directory",
+ *   "output": "/absolute/output/directory",
+ *   "resume": false,
+ *   "cache": "/absolute/cache/directory",
+ *   "archive": 4294967296,
+ *   "settings": { ... }
+ * }
+ *
+ * the optional settings object is described in configure(), the optional cache directory in
+ * setCacheDirectory() and the optional archive shard size in setArchiveOutput(). Results are reported through
+ * resultReady() while the job runs, and the outcome through finished().
+ *
+ * @param job the json job description
+ */
+void MorphEngine::runJob(const QJsonObject &job)
+{
+    clear();
+    resetSettings();
+    setResume(job["resume"].toBool());
+    setCacheDirectory(job["cache"].toString());
+    setArchiveOutput((qint64)job["archive"].toDouble());
+    setManifestOutput(true);
+    bool ok = !job.contains("settings") || configure(job["settings"].toObject());
+    ok = ok && addImages(job["input"].toString());
+    ok = ok && run(job["output"].toString());
+    emit finished(ok, errorString());
+}
+
+/**
+ * @brief MorphEngine::configure
+ *
+ * Reads the *.json settings file and applies it, see configure(const QJsonObject &).
+ *
+ * @param json_path a path to the *.json settings file
+ * @return true if the settings file could be read and parsed
+ */
+bool MorphEngine::configure(const QString &json_path)
+{
+    QFile json_file(json_path);
+    if(!json_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return fail(SETTINGS_ERROR, "Unable to open the json settings: " + json_path);
+    QJsonParseError parse_error;
+    QJsonDocument document = QJsonDocument::fromJson(json_file.readAll(), &parse_error);
+    json_file.close();
+    if(!document.isObject())
+        return fail(SETTINGS_ERROR, "Failed to parse the json settings: " + parse_error.errorString());
+    return configure(document.object());
+}
+
+/**
+ * @brief MorphEngine::configure
+ *
+ * A procedure to apply the settings of a job, the settings must be applied before
+ * images are added, as the resolution is fixed once the first images are loaded.
+ *
+ * An example json file:
+ * {
+ *   "resolution": [-1, -1],
+ *   "alpha": 0.5,
+ *   "h-filter": 0,
+ *   "g-filter": 0,
+ *   "m-filter": 20,
+ *   "b-filter": 100,
+ *   "transform": 1,
+ *   "sharpness": 30,
+ *   "contrast": 40,
+ *   "brightness": 50,
+ *   "allow-bad-morphs": false,
+ *   "format": 1
+ * }
+ *
+ * please note that the json file MUST NOT contain other values than these, with the exception
+ * of the optional "spectral-filter" object and the optional encoder settings. A value which
+ * is left out keeps its current setting, i.e. the default after resetSettings():
+ *
+ *   "spectral-filter": {"mask": "low-pass", "cutoff": 0.5, "width": 0.1}
+ *   "jpeg-quality": 90
+ *   "png-compression": 1
+ *
+ * resolution: a 2d array specifying width and height, if
+ * the values are -1, -1 it will automatically be determined
+ * by the application.
+ *
+ * float alpha: RANGE: [0,1] a value controlling how much the resulting morph will
+ * resmble reference one and two. 0.5 meaning both references are
+ * valued equally in the alpha blending stage. Hence alpha=0 should
+ * produce an output equal to reference-one image. alpha=1 should produce
+ * an output equal to reference-two image.
+ *
+ * unsigned int h-filter: suggested RANGE: [0,100] a value controlling the amount
+ * of homogenous smoothing added as a post-processing effect to the morphed
+ * result. h-filter=0 implies that no homogenous smoothing will be added.
+ * h-filter=100 results in a high intensity homogenous filtering.
+ *
+ * unsigned int g-filter: suggested RANGE: [0,100] a value controlling the amount
+ * of gaussian smoothing added as a post-processing effect to the morphed
+ * result. g-filter=0 implies that no gaussian smoothing will be added.
+ * g-filter=100 results in a high intensity gaussian filtering.
+ *
+ * unsigned int m-filter: suggested RANGE: [0,100] a value controlling the amount
+ * of median smoothing added as a post-processing effect to the morphed
+ * result. m-filter=0 implies that no median smoothing will be added.
+ * m-filter=100 results in a high intensity median filtering.
+ *
+ * unsigned int b-filter: suggested RANGE: [0,100] a value controlling the amount
+ * of bilateral smoothing added as a post-processing effect to the morphed
+ * result. b-filter=0 implies that no bilateral smoothing will be added.
+ * b-filter=100 results in a high intensity bilateral filtering. WARNING: expensive
+ *
+ * unsigned int transform: suggested RANGE: [0,1], transform=0 will result in no transformation
+ * added to the morphed results. transform=1 will result in grayscale results, the images
+ * are morphed, filtered and saved as a single channel.
+ *
+ * unsigned int sharpness: suggested RANGE: [0,100], a parameter controlling the
+ * amount of sharpness added to the morphed results. sharpness=0 implies that no
+ * sharpening effect will be added to the morphed results. sharpness=100 results
+ * in a high intensity sharpness effect added to the morphed results.
+ *
+ * unsigned int contrast: suggested RANGE: [0,100], a parameter controlling the
+ * amount of contrast added to the morphed results. contrast=0 implies that no
+ * contrast will be added to the morphed results. contrast=100 results in a high
+ * intensity contrast effect added to the morphed results.
+ *
+ * unsigned int brightness: suggested RANGE: [0,100], a parameter controlling the
+ * amount of brightness added to the morphed results. brightness=0 implies that no
+ * brightness will be added to the morphed results. brightness=100 results in a high
+ * intensity brightness effect added to the morphed results.
+ *
+ * bool allow-bad-morphs: RANGE: [true,false], if the input images does not contain
+ * an entire face, the dlib library used to identify facial landmarks will falsely
+ * report a facial landmark outside the image boundaries, an effect of this is
+ * un-warped areas in the resulting morph, the suggested value of this parameter
+ * is hence false, as the results will be significantly better.
+ *
+ * unsigned int format: suggested RANGE: [0,2], the parameter specifies the format
+ * of the output images. format=0 results in jpeg formatted outputs. format=1
+ * results in png formatted outputs. format=2 results in uncompressed ppm outputs,
+ * pgm for grayscale results, for pipelines which decode the results again.
+ *
+ * int jpeg-quality: optional RANGE: [0,100], the quality of jpeg outputs, the default
+ * quality of Qt if omitted.
+ *
+ * int png-compression: optional RANGE: [0,9], the zlib level of png outputs, 0 is the
+ * fastest, the default level of Qt if omitted. The default level is slow for large jobs.
+ *
+ * object spectral-filter: optional, filters the morphed results in the frequency domain
+ * after the other post-processing effects. mask is one of "low-pass", "high-pass",
+ * "band-pass" or "notch". cutoff and width are radii normalized such that 1 corresponds
+ * to the nyquist frequency, see ImageProcessor::spectralFilter.
+ *
+ * @param object the json settings object
+ * @return true if the settings were correctly parsed.
+ */
+bool MorphEngine::configure(const QJsonObject &object)
+{
+    QJsonArray resolution = object["resolution"].toArray();
+    m_image_width = resolution.at(0).toInt(m_image_width);
+    m_image_height = resolution.at(1).toInt(m_image_height);
+    if((m_image_width != -1 && m_image_width <= 0) || (m_image_height != -1 && m_image_height <= 0))
+        return fail(SETTINGS_ERROR, "Invalid resolution: " + QString::number(m_image_width) + "x" + QString::number(m_image_height));
+    m_alpha = (float)object["alpha"].toDouble(m_alpha);
+    m_h_filter = object["h-filter"].toInt(m_h_filter);
+    m_g_filter = object["g-filter"].toInt(m_g_filter);
+    m_m_filter = object["m-filter"].toInt(m_m_filter);
+    m_b_filter = object["b-filter"].toInt(m_b_filter);
+    m_transform = object["transform"].toInt(m_transform);
+    m_sharpness = object["sharpness"].toInt(m_sharpness);
+    m_contrast = object["contrast"].toInt(m_contrast);
+    m_brightness = object["brightness"].toInt(m_brightness);
+    m_allow_bad_morphs = object["allow-bad-morphs"].toBool(m_allow_bad_morphs);
+    m_format = object["format"].toInt(m_format);
+    m_jpeg_quality = object["jpeg-quality"].toInt(m_jpeg_quality);
+    m_png_compression = object["png-compression"].toInt(m_png_compression);
+    configureEncoder(m_encoder);
+    if(object.contains("spectral-filter")) {
+        QJsonObject spectral = object["spectral-filter"].toObject();
+        QStringList masks = QStringList() << "none" << "low-pass" << "high-pass" << "band-pass" << "notch";
+        int mask = masks.indexOf(spectral["mask"].toString());
+        if(mask < 0) return fail(SETTINGS_ERROR, "Unknown spectral-filter mask: " + spectral["mask"].toString());
+        m_spectral_mask = (ImageProcessor::SpectralMask)mask;
+        m_spectral_cutoff = (float)spectral["cutoff"].toDouble(m_spectral_cutoff);
+        m_spectral_width = (float)spectral["width"].toDouble(m_spectral_width);
+    }
+
+    emit message("image_width: " + QString::number(m_image_width));
+    emit message("image_height: " + QString::number(m_image_height));
+    emit message("alpha: " + QString::number(m_alpha));
+    emit message("homogenous filter: " + QString::number(m_h_filter));
+    emit message("gaussian filter: " + QString::number(m_g_filter));
+    emit message("median filter: " + QString::number(m_m_filter));
+    emit message("bilateral filter: " + QString::number(m_b_filter));
+    emit message(QString("transform: ") + (m_transform == 0 ? "normal" : "grayscale"));
+    emit message("sharpness: " + QString::number(m_sharpness));
+    emit message("contrast: " + QString::number(m_contrast));
+    emit message("brightness: " + QString::number(m_brightness));
+    emit message(QString("allow bad morphs: ") + (m_allow_bad_morphs ? "true" : "false"));
+    emit message("format: " + m_encoder.extension(m_transform > 0).mid(1) + " jpeg quality: "
+                 + QString::number(m_jpeg_quality) + " png compression: " + QString::number(m_png_compression));
+    emit message("spectral filter: " + QString::number(m_spectral_mask) + " cutoff: " + QString::number(m_spectral_cutoff)
+                 + " width: " + QString::number(m_spectral_width));
+    return true;
+}
+
+/**
+ * @brief MorphEngine::addImages
+ *
+ * Adds the *.jpg, *.jpeg and *.png images of a directory, the image members of a tar
+ * archive or the images of a list file to the job, see fmg::ImageSource and
+ * addImages(const QStringList &). Archive members are read in place.
+ *
+ * @param input_dir a directory, tar archive or list file path of the input images
+ * @return true if images were found and succesfully loaded.
+ */
+bool MorphEngine::addImages(const QString &input_dir)
+{
+    QStringList paths = fmg::ImageSource::list(input_dir);
+    if(paths.isEmpty())
+        return fail(INPUT_ERROR, "No images found in: " + QDir().absoluteFilePath(input_dir));
+    paths.sort(); // the pair space must be identical for every shard, see setShard()
+    return addImages(paths);
+}
+
+/**
+ * @brief MorphEngine::addImages
+ *
+ * Loads the images into the job, every image is scaled to the job resolution. If the
+ * settings contained a "resolution": [-1,-1] value and no images were loaded yet, the
+ * resolution is determined as the lowest resolution of the images, note that the original
+ * files are not modified.
+ *
+ * A sharded job takes all of its images in one call, only the images touched by the pairs
+ * of the shard are loaded. With setMemoryBudget() the images are only registered here and
+ * decoded when they are needed, see fmg::ImageStore.
+ *
+ * @param paths the image file paths
+ * @return true if the images were succesfully loaded.
+ */
+bool MorphEngine::addImages(const QStringList &paths)
+{
+    if(m_shard_count > 1 && m_image_count > 0)
+        return fail(INPUT_ERROR, "A sharded job takes all of its images at once");
+    if(!resolveResolution(paths)) return false;
+    m_store.setContext(m_context);
+
+    int first = m_image_count;
+    m_image_count += paths.size();
+    if(m_shard_count > 1 && !planShards(m_image_count)) return false;
+    std::vector<bool> touched = shardImages(m_image_count);
+    for(int i = 0; i < paths.size(); ++i) {
+        if(!touched[first + i]) continue;
+        const QString &path = paths[i];
+        int position = m_store.add(path, fileDigest(path));
+        if(m_store.budget() == 0) {
+            emit message("Loading: " + path);
+            if(!m_store.image(position)) {
+                m_store.removeLast();
+                return fail(LOAD_ERROR, "Failed to load: " + path);
+            }
+        }
+        m_indices.push_back(first + i);
+        m_positions.insert(first + i, position);
+    }
+    return true;
+}
+
+/**
+ * @brief MorphEngine::registerImages
+ *
+ * Registers the images of a job of which only some pairs are morphed by this engine, e.g.
+ * the batches of a distributed job, see MorphBatchRunner. None of the images are loaded
+ * yet, imagePosition() loads them on demand. The resolution must be configured, such that
+ * every engine of the job scales the images alike.
+ *
+ * @param paths the image file paths of the job
+ * @return true if the resolution of the job is known
+ */
+bool MorphEngine::registerImages(const QStringList &paths)
+{
+    bool ok = resolveResolution(paths);
+    m_store.setContext(m_context);
+    if(!ok) return false;
+    m_paths = paths;
+    m_image_count = paths.size();
+    return true;
+}
+
+/**
+ * @brief MorphEngine::run
+ *
+ * Detects the landmarks of the added images which have not been processed yet and morphs
+ * every image with each other, applying the configured filters and saving the results to
+ * the output directory. Note that this results in O(N^2) morphs, N = amount of images added.
+ *
+ * The engine is incremental, images added after a previous run() are only morphed with
+ * the images before them and with each other, in both orders, pairs which were already
+ * produced are never recomputed. Hence adding one image to N processed images costs 2N
+ * morphs. The images are processed in the order they were added.
+ *
+ * With setMemoryBudget() the pairs are visited in blocks of images, every pair between two
+ * blocks is morphed while both blocks are resident, hence an image is decoded about N / B
+ * times rather than for every pair, B = the images per block, see fmg::ImageStore.
+ *
+ * Outputs are named deterministically from the input content and the settings, and every
+ * completed output is appended to the manifest of the output directory. With setResume()
+ * the outputs recorded in the manifest, whose content still matches, are skipped, hence an
+ * interrupted run continues where it stopped.
+ *
+ * A pair which could not be saved is reported in its MorphResult, the remaining pairs are
+ * still processed. The individual morphing procedures are explained in the routines of the
+ * ImageProcessor class.
+ *
+ * @param output_dir a directory path to the output images
+ * @return true if every result was saved, false on cancellation or failure, see error()
+ */
+bool MorphEngine::run(const QString &output_dir)
+{
+    resetRun();
+    if(!beginRun(output_dir) || !openOutput()) return false;
+    detectLandmarks();
+
+    int n = m_store.size();
+    int block = m_store.blockSize();
+    int total = 0;
+    for(int k = std::max(m_processed, 1); k < n; ++k) {
+        for(int j = 0; j < k; ++j) total += ownsPair(k, j) ? 2 : 0;
+    }
+    int done = 0;
+    bool saved_all = true;
+    for(int row = std::max(m_processed, 1); row < n; row += block) {
+        int row_end = std::min(row + block, n);
+        for(const QPair<int, int> &pair : pairBlock(row, row_end)) {
+            if(m_canceled) return failRun(CANCELED, "Canceled");
+            // first is a new image, second is either an existing or an earlier new image
+            saved_all = morphPair(pair.first, pair.second) && saved_all;
+            saved_all = morphPair(pair.second, pair.first) && saved_all;
+            if(!m_ring_name.isEmpty() && !m_ring.isOpen() && !m_canceled)
+                return failRun(OUTPUT_ERROR, m_ring.errorString());
+            done += 2;
+            emit progress(done, total);
+        }
+        m_processed = row_end; // every pair of the first row_end images was submitted
+    }
+    return endRun(saved_all);
+}
+
+/**
+ * @brief MorphEngine::resetRun
+ *
+ * The first step of a run, clears the cancellation, the error and the throughput
+ * statistics of the previous run.
+ *
+ */
+void MorphEngine::resetRun()
+{
+    m_canceled = false;
+    m_error = NONE;
+    m_error_string.clear();
+    m_morph_nsecs = 0;
+    m_morphed = 0;
+    m_encoder.resetStatistics();
+}
+
+/**
+ * @brief MorphEngine::beginRun
+ *
+ * Prepares the output directory of a run, its manifest and the settings digest which names
+ * the outputs, see openManifest().
+ *
+ * @param output_dir a directory path to the output images
+ * @return true if the outputs can be written, see error() otherwise
+ */
+bool MorphEngine::beginRun(const QString &output_dir)
+{
+    QString output_directory = QDir().absoluteFilePath(output_dir);
+    if(!QDir().mkpath(output_directory))
+        return fail(OUTPUT_ERROR, "Unable to create the output directory: " + output_directory);
+    if(m_image_count < 2)
+        return fail(INPUT_ERROR, "At least two images are required");
+    if(!openManifest(output_directory))
+        return fail(OUTPUT_ERROR, "Unable to open the manifest: " + m_manifest.fileName());
+    m_output_directory = output_directory;
+    m_settings_digest = settingsDigest();
+    return true;
+}
+
+/**
+ * @brief MorphEngine::openOutput
+ *
+ * Opens the result archive, see setArchiveOutput(), or creates the shared memory ring, see
+ * setSharedMemoryOutput(), of a run begun by beginRun(). Both are closed by endRun() or
+ * failRun().
+ *
+ * @param archive_suffix appended to the prefix of the archive shards, e.g. to give every
+ * process of a run archives of its own
+ * @return true if the output is open, see error() otherwise
+ */
+bool MorphEngine::openOutput(const QString &archive_suffix)
+{
+    if(m_archive_size > 0 && !m_archive.open(m_output_directory, archivePrefix() + archive_suffix, m_archive_size))
+        return fail(OUTPUT_ERROR, m_archive.errorString());
+    if(!m_ring_name.isEmpty()) {
+        QSize size(m_context.img_width, m_context.img_height);
+        if(!m_ring.create(m_ring_name, m_ring_slots, size, m_transform > 0 ? 1 : 3))
+            return fail(OUTPUT_ERROR, m_ring.errorString());
+        m_ring.setTimeout(m_ring_timeout);
+        emit message("Publishing the morphs to the shared memory: " + m_ring_name);
+    }
+    return true;
+}
+
+/**
+ * @brief MorphEngine::pendingPairs
+ *
+ * The unordered pairs run() visits, in its blocked order, such that a driver distributing
+ * them keeps the decoded images of consecutive pairs reusable.
+ *
+ * @return the pairs (row image, column image) of the images added since the last run,
+ * owned by the shard
+ */
+QList<QPair<int, int>> MorphEngine::pendingPairs() const
+{
+    int n = m_store.size();
+    int block = m_store.blockSize();
+    QList<QPair<int, int>> pending;
+    for(int row = std::max(m_processed, 1); row < n; row += block)
+        pending += pairBlock(row, std::min(row + block, n));
+    return pending;
+}
+
+/**
+ * @brief MorphEngine::recordResult
+ *
+ * Records a result in the manifest, if it was saved, and reports it through resultReady(),
+ * e.g. a result saved by another process of the run.
+ *
+ * @param result the result
+ */
+void MorphEngine::recordResult(const MorphResult &result)
+{
+    if(result.error.isEmpty()) {
+        m_completed.insert(QFileInfo(result.path).fileName(), result.digest.toLatin1());
+        if(m_manifest.isOpen()) {
+            m_manifest.write(manifestEntry(result) + "\n");
+            m_manifest.flush();
+        }
+    }
+    m_results.push_back(result);
+    emit resultReady(result);
+}
+
+/**
+ * @brief MorphEngine::takeResults
+ * @return the results reported since the last call, which are removed from results()
+ */
+std::vector<MorphResult> MorphEngine::takeResults()
+{
+    std::vector<MorphResult> results;
+    results.swap(m_results);
+    return results;
+}
+
+/**
+ * @brief MorphEngine::endRun
+ *
+ * The last step of a run whose pairs were all submitted, waits for the encoder, closes the
+ * output and reports the throughput.
+ *
+ * @param saved_all false if a result of the run could not be saved
+ * @return true if every result was saved, see results() otherwise
+ */
+bool MorphEngine::endRun(bool saved_all)
+{
+    saved_all = collectEncoded(true) && saved_all;
+    m_archive.close();
+    m_ring.close();
+    m_processed = m_store.size();
+    reportThroughput(m_encoder);
+    if(!saved_all) return fail(OUTPUT_ERROR, "Some results could not be saved, see results()");
+    return true;
+}
+
+/**
+ * @brief MorphEngine::failRun
+ *
+ * Stops a run, the results submitted so far are still saved and recorded and the output is
+ * closed.
+ *
+ * @param error the Error
+ * @param text the description of the error
+ * @return false
+ */
+bool MorphEngine::failRun(Error error, const QString &text)
+{
+    collectEncoded(true);
+    m_archive.close();
+    m_ring.close();
+    return fail(error, text);
+}
+
+/**
+ * @brief MorphEngine::cancel
+ *
+ * Requests the running job to stop after the current pair, thread-safe.
+ *
+ */
+void MorphEngine::cancel()
+{
+    m_canceled = true;
+}
+
+/**
+ * @brief MorphEngine::isCanceled
+ * @return true if cancel() was invoked since the last resetRun()
+ */
+bool MorphEngine::isCanceled() const
+{
+    return m_canceled;
+}
+
+/**
+ * @brief MorphEngine::setResume
+ *
+ * Skips the outputs recorded in the manifest of the output directory, see run().
+ *
+ * @param resume true to continue an interrupted run
+ */
+void MorphEngine::setResume(bool resume)
+{
+    m_resume = resume;
+}
+
+/**
+ * @brief MorphEngine::setCacheDirectory
+ *
+ * Enables the fmg::PixelCache of the decoded and scaled images, later runs over the same
+ * images at the same resolution map the cached pixels instead of decoding the files. The
+ * filters and the alpha are not part of the key, hence runs with other settings share it.
+ *
+ * @param directory the cache directory, empty to disable the cache
+ */
+void MorphEngine::setCacheDirectory(const QString &directory)
+{
+    m_store.setCacheDirectory(directory);
+}
+
+/**
+ * @brief MorphEngine::setMemoryBudget
+ *
+ * Limits the decoded images kept in memory, the images are decoded on demand and the pairs
+ * are morphed in blocks which fit in the budget, see run(). Without a budget every image
+ * is decoded by addImages() and stays resident.
+ *
+ * @param bytes the budget in bytes, 0 for unlimited
+ */
+void MorphEngine::setMemoryBudget(qint64 bytes)
+{
+    m_store.setBudget(bytes);
+}
+
+/**
+ * @brief MorphEngine::setEncoderThreads
+ *
+ * Sets the threads encoding and saving the results while the next pairs are morphed, see
+ * fmg::ImageEncoder. Forked workers, see MorphPreforker, always encode on their own thread.
+ *
+ * @param threads the amount of encoder threads, 0 to encode after every morph
+ */
+void MorphEngine::setEncoderThreads(int threads)
+{
+    m_encoder.setThreads(threads);
+}
+
+/**
+ * @brief MorphEngine::setArchiveOutput
+ *
+ * Packs the results into tar shards of the output directory, with an index of the offsets
+ * of every result, rather than writing a file per result, see fmg::ResultArchive. The
+ * manifest records the shard of every result, a resumed run continues the shards.
+ *
+ * @param shard_size the size in bytes beyond which a new shard is started, 0 to write files
+ */
+void MorphEngine::setArchiveOutput(qint64 shard_size)
+{
+    m_archive_size = std::max(shard_size, (qint64)0);
+    m_encoder.setWriteFiles(m_archive_size == 0);
+}
+
+/**
+ * @brief MorphEngine::setSharedMemoryOutput
+ *
+ * Publishes the raw morphs into a ring in POSIX shared memory instead of encoding and saving
+ * them, such that a local consumer process reads them in place, see fmg::FrameRing. Every
+ * frame carries the indices of its pair, alpha and the landmarks of the morph. The run
+ * waits while the consumer lags slot_count frames behind, and fails with OUTPUT_ERROR once
+ * the consumer exited or released no frame within the timeout. Nothing is recorded in the
+ * manifest, a shared memory run can not be resumed.
+ *
+ * @param name the shared memory name, empty to encode and save the results
+ * @param slot_count the amount of frames in the ring
+ * @param timeout_msecs the time to wait for the consumer of a full ring, 0 to wait as long
+ * as a consumer is attached and alive, see fmg::FrameRing::setTimeout()
+ */
+void MorphEngine::setSharedMemoryOutput(const QString &name, int slot_count, int timeout_msecs)
+{
+    m_ring_name = name;
+    m_ring_slots = slot_count;
+    m_ring_timeout = timeout_msecs;
+}
+
+/**
+ * @brief MorphEngine::hasSharedMemoryOutput
+ * @return true if the morphs are published to shared memory, see setSharedMemoryOutput()
+ */
+bool MorphEngine::hasSharedMemoryOutput() const
+{
+    return !m_ring_name.isEmpty();
+}
+
+/**
+ * @brief MorphEngine::setManifestOutput
+ *
+ * Sets whether the engine appends its results to the manifest of the output directory, the
+ * default. A job whose results are recorded by another process, e.g. the coordinator of a
+ * distributed job, only reads the manifest to resume.
+ *
+ * @param write true to append to the manifest, false to close it
+ */
+void MorphEngine::setManifestOutput(bool write)
+{
+    m_write_manifest = write;
+    if(!write) m_manifest.close();
+}
+
+/**
+ * @brief MorphEngine::setShard
+ *
+ * Restricts the job to shard index of count, count independent processes with the same
+ * images and settings produce disjoint subsets of the pairs which together are complete.
+ * The sorted images are split into contiguous blocks and every unordered pair of blocks is
+ * assigned to one shard, hence both orders of a pair belong to the same shard and a shard
+ * only loads and detects the landmarks of the images of its blocks, see shardOf().
+ * Must be set before images are added.
+ *
+ * @param index the shard of this process, RANGE: [0, count)
+ * @param count the amount of shards
+ * @return true if the shard is valid
+ */
+bool MorphEngine::setShard(int index, int count)
+{
+    if(count < 1 || index < 0 || index >= count)
+        return fail(SETTINGS_ERROR, "Invalid shard: " + QString::number(index) + "/" + QString::number(count));
+    m_shard_index = index;
+    m_shard_count = count;
+    return true;
+}
+
+/**
+ * @brief MorphEngine::shardOf
+ *
+ * Assigns a pair to a shard. The images are split into shardBlocks() contiguous blocks and
+ * every unordered pair of blocks is owned by the shard planShards() assigned it to.
+ *
+ * @param one the index of the first image, among the sorted images of the job
+ * @param two the index of the second image
+ * @return the shard owning the pair, both orders of a pair have the same owner
+ */
+int MorphEngine::shardOf(int one, int two) const
+{
+    int blocks = m_shard_blocks;
+    int a = (int)((qint64)one * blocks / m_image_count);
+    int b = (int)((qint64)two * blocks / m_image_count);
+    if(a > b) std::swap(a, b);
+    return m_shard_table[a * blocks - a * (a - 1) / 2 + (b - a)]; // row-major index of (a, b), a <= b
+}
+
+/**
+ * @brief MorphEngine::shardBlocks
+ *
+ * A diagonal block pair holds half the pairs of an off-diagonal one, hence g blocks make
+ * g * g half-block units of work. The amount of blocks is the smallest g for which every
+ * shard gets at least 8 units and assignShards() deals them within one unit of each other,
+ * hence no shard exceeds an even split by much more than an eighth. More blocks balance
+ * better, but a shard touches more images.
+ *
+ * @param shards the amount of shards
+ * @return the amount of blocks the images are split into
+ */
+int MorphEngine::shardBlocks(int shards)
+{
+    if(shards <= 1) return 1;
+    for(int blocks = 2; ; ++blocks) {
+        if(blocks * blocks < 8 * shards) continue;
+        std::vector<qint64> units;
+        for(int a = 0; a < blocks; ++a) {
+            for(int b = a; b < blocks; ++b) units.push_back(a == b ? 1 : 2);
+        }
+        std::vector<int> table = assignShards(units, shards);
+        std::vector<qint64> loads(shards, 0);
+        for(size_t i = 0; i < units.size(); ++i) loads[table[i]] += units[i];
+        if(*std::max_element(loads.begin(), loads.end()) - *std::min_element(loads.begin(), loads.end()) <= 1)
+            return blocks;
+    }
+}
+
+/**
+ * @brief MorphEngine::assignShards
+ *
+ * Deals the block pairs to the shards, largest first, each to the shard with the fewest
+ * pairs so far, ties going to the lower shard and the earlier block pair. The shards hence
+ * differ by at most the pairs of one block pair, and every process derives the same table.
+ *
+ * @param pairs the amount of pairs of every block pair
+ * @param shards the amount of shards
+ * @return the shard of every block pair
+ */
+std::vector<int> MorphEngine::assignShards(const std::vector<qint64> &pairs, int shards)
+{
+    std::vector<int> order(pairs.size());
+    for(size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    std::stable_sort(order.begin(), order.end(), [&pairs](int x, int y) { return pairs[x] > pairs[y]; });
+    std::vector<qint64> loads(shards, 0);
+    std::vector<int> table(pairs.size(), 0);
+    for(int block_pair : order) {
+        int shard = (int)(std::min_element(loads.begin(), loads.end()) - loads.begin());
+        table[block_pair] = shard;
+        loads[shard] += pairs[block_pair];
+    }
+    return table;
+}
+
+/**
+ * @brief MorphEngine::mergeManifests
+ *
+ * Combines the shard manifests of an output directory into its manifest, such that the
+ * merged outputs can be resumed by an unsharded run. The shard manifests are kept, an
+ * output recorded more than once is kept once.
+ *
+ * @param output_dir the directory holding the outputs and manifests of the shards
+ * @return true if the manifest was written
+ */
+bool MorphEngine::mergeManifests(const QString &output_dir)
+{
+    QDir directory(QDir().absoluteFilePath(output_dir));
+    QStringList shards = directory.entryList(QStringList() << "manifest.shard-*.jsonl", QDir::Files, QDir::Name);
+    if(shards.isEmpty()) return fail(INPUT_ERROR, "No shard manifests found in: " + directory.absolutePath());
+
+    QStringList names;
+    QHash<QString, QByteArray> entries;
+    for(const QString &manifest : QStringList(shards) << MANIFEST_NAME) {
+        QFile file(directory.absoluteFilePath(manifest));
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) continue;
+        while(!file.atEnd()) {
+            QByteArray line = file.readLine().trimmed();
+            QString name = QJsonDocument::fromJson(line).object()["name"].toString();
+            if(name.isEmpty()) continue; // truncated by a crash
+            if(!entries.contains(name)) names << name;
+            entries.insert(name, line);
+        }
+        emit message("Merged: " + file.fileName());
+    }
+
+    QSaveFile merged(directory.absoluteFilePath(MANIFEST_NAME));
+    if(!merged.open(QIODevice::WriteOnly | QIODevice::Text))
+        return fail(OUTPUT_ERROR, "Unable to write: " + merged.fileName());
+    for(const QString &name : names) merged.write(entries.value(name) + "\n");
+    if(!merged.commit()) return fail(OUTPUT_ERROR, "Unable to write: " + merged.fileName());
+    emit message(QString::number(names.size()) + " outputs recorded in: " + merged.fileName());
+    return true;
+}
+
+/**
+ * @brief MorphEngine::clear
+ *
+ * Removes the images and results of the previous job, the settings and the loaded shape
+ * predictor are kept. The next run() morphs every pair again.
+ *
+ */
+void MorphEngine::clear()
+{
+    m_context = fmg::MorphContext();
+    m_processed = 0;
+    m_store.clear();
+    m_store.setContext(m_context);
+    m_indices.clear();
+    m_positions.clear();
+    m_paths.clear();
+    m_image_count = 0;
+    m_manifest.close();
+    m_manifest.setFileName(QString());
+    m_completed.clear();
+    m_verified.clear();
+    m_deferred.clear();
+    m_results.clear();
+    m_error = NONE;
+    m_error_string.clear();
+}
+
+/**
+ * @brief MorphEngine::results
+ * @return the results of the morphed pairs, in the order they were produced
+ */
+const std::vector<MorphResult> &MorphEngine::results() const
+{
+    return m_results;
+}
+
+/**
+ * @brief MorphEngine::error
+ * @return the Error of the last failed call, NONE if none failed
+ */
+MorphEngine::Error MorphEngine::error() const
+{
+    return m_error;
+}
+
+/**
+ * @brief MorphEngine::errorString
+ * @return a description of the last error
+ */
+QString MorphEngine::errorString() const
+{
+    return m_error_string;
+}
+
+/**
+ * @brief MorphEngine::resetSettings
+ *
+ * A private convenience method restoring the default settings documented in configure().
+ *
+ */
+void MorphEngine::resetSettings()
+{
+    m_image_width = -1;
+    m_image_height = -1;
+    m_alpha = 0.5;
+    m_h_filter = 0;
+    m_g_filter = 0;
+    m_m_filter = 0;
+    m_b_filter = 0;
+    m_transform = 0;
+    m_sharpness = 0;
+    m_contrast = 0;
+    m_brightness = 0;
+    m_allow_bad_morphs = false;
+    m_format = 0;
+    m_jpeg_quality = -1;
+    m_png_compression = -1;
+    configureEncoder(m_encoder);
+    m_spectral_mask = ImageProcessor::NO_MASK;
+    m_spectral_cutoff = 0.5;
+    m_spectral_width = 0.1;
+}
+
+/**
+ * @brief MorphEngine::fail
+ *
+ * A private convenience method recording an error.
+ *
+ * @param error the Error
+ * @param text the description of the error
+ * @return false
+ */
+bool MorphEngine::fail(Error error, const QString &text)
+{
+    m_error = error;
+    m_error_string = text;
+    return false;
+}
+
+/**
+ * @brief MorphEngine::resolveResolution
+ *
+ * Determines the job resolution, the configured resolution or, if it was not configured,
+ * the lowest resolution of the images, read from their headers, see fmg::ImageProbe.
+ *
+ * @param paths the image file paths of the first images added
+ * @return true if the resolution is known
+ */
+bool MorphEngine::resolveResolution(const QStringList &paths)
+{
+    if(m_context.isValid()) return true; // resolved by the images added before
+    if(m_image_width != -1 && m_image_height != -1) {
+        m_context.img_width = m_image_width;
+        m_context.img_height = m_image_height;
+        return true;
+    }
+    if(paths.isEmpty()) return fail(INPUT_ERROR, "No images provided");
+    QString unreadable;
+    QSize minimum = fmg::ImageProbe::minimumSize(paths, &unreadable);
+    if(!minimum.isValid()) return fail(LOAD_ERROR, "Failed to load: " + unreadable);
+    m_context.img_width = minimum.width();
+    m_context.img_height = minimum.height();
+    return true;
+}
+
+/**
+ * @brief MorphEngine::planShards
+ *
+ * A private convenience method assigning the block pairs of the job to the shards by their
+ * ordered pair counts, see assignShards(). Every shard is verified to be within one block
+ * pair of N(N-1)/shards pairs.
+ *
+ * @param images the amount of images of the job
+ * @return true if the shards are balanced
+ */
+bool MorphEngine::planShards(int images)
+{
+    int blocks = shardBlocks(m_shard_count);
+    std::vector<qint64> sizes(blocks, 0);
+    for(int i = 0; i < images; ++i) ++sizes[(int)((qint64)i * blocks / images)];
+    std::vector<qint64> pairs;
+    for(int a = 0; a < blocks; ++a) {
+        for(int b = a; b < blocks; ++b) pairs.push_back(a == b ? sizes[a] * (sizes[a] - 1) : 2 * sizes[a] * sizes[b]);
+    }
+    m_shard_blocks = blocks;
+    m_shard_table = assignShards(pairs, m_shard_count);
+
+    std::vector<qint64> loads(m_shard_count, 0);
+    for(size_t i = 0; i < pairs.size(); ++i) loads[m_shard_table[i]] += pairs[i];
+    double even = (double)images * (images - 1) / m_shard_count;
+    qint64 block_pair = *std::max_element(pairs.begin(), pairs.end());
+    for(int shard = 0; shard < m_shard_count; ++shard) {
+        if(std::fabs(loads[shard] - even) > block_pair)
+            return fail(SETTINGS_ERROR, "Unbalanced shard " + QString::number(shard) + ": "
+                        + QString::number(loads[shard]) + " pairs of " + QString::number(even));
+    }
+    emit message("shard " + QString::number(m_shard_index) + ": " + QString::number(loads[m_shard_index])
+                 + " pairs in " + QString::number(blocks) + " blocks");
+    return true;
+}
+
+/**
+ * @brief MorphEngine::shardImages
+ *
+ * A private convenience method to determine the images touched by the pairs of the shard.
+ *
+ * @param images the amount of images of the job
+ * @return a flag for every image, true if the image has to be loaded
+ */
+std::vector<bool> MorphEngine::shardImages(int images) const
+{
+    if(m_shard_count <= 1) return std::vector<bool>(images, true);
+    int blocks = m_shard_blocks;
+    std::vector<bool> touched_blocks(blocks, false);
+    int block_pair = 0;
+    for(int a = 0; a < blocks; ++a) {
+        for(int b = a; b < blocks; ++b, ++block_pair) {
+            if(m_shard_table[block_pair] != m_shard_index) continue;
+            touched_blocks[a] = true;
+            touched_blocks[b] = true;
+        }
+    }
+    std::vector<bool> touched(images, false);
+    for(int i = 0; i < images; ++i) touched[i] = touched_blocks[(int)((qint64)i * blocks / images)];
+    return touched;
+}
+
+/**
+ * @brief MorphEngine::morphPair
+ *
+ * Morphs one ordered pair of a run begun by beginRun(), applies the configured filters and
+ * saves the result. Pairs with missing or, unless allowed, bad landmarks are skipped. When
+ * resuming, a pair whose output is recorded in the manifest and verified is not morphed
+ * again. The result is handed to the encoder, which writes it atomically, and recorded in
+ * the manifest once it is saved, see collectEncoded(), or published to the shared memory
+ * ring, see setSharedMemoryOutput().
+ *
+ * @param one the index of the first reference
+ * @param two the index of the second reference
+ * @return false if a result saved meanwhile could not be saved
+ */
+bool MorphEngine::morphPair(int one, int two)
+{
+    FaceImage &entry_one = m_store.entry(one);
+    FaceImage &entry_two = m_store.entry(two);
+    MorphResult result;
+    result.reference_one = entry_one.getImagePath().toString();
+    result.reference_two = entry_two.getImagePath().toString();
+    QString name = outputName(one, two);
+    QString path = m_output_directory + "/" + name;
+    if(m_resume && isRecorded(one, two)) {
+        result.path = path;
+        result.digest = QString::fromLatin1(m_completed.value(name));
+        m_results.push_back(result);
+        emit resultReady(result);
+        return true;
+    }
+
+    if(!entry_one.hasLandmarks() || (entry_one.hasBadLandmarks(m_context) && !m_allow_bad_morphs)) return true;
+    if(!entry_two.hasLandmarks() || (entry_two.hasBadLandmarks(m_context) && !m_allow_bad_morphs)) return true;
+    // the pixels are only needed now, skipped pairs never decode their images
+    FaceImage *ref_one = m_store.image(one);
+    FaceImage *ref_two = m_store.image(two);
+    if(!ref_one || !ref_two) {
+        result.error = "Failed to load: " + (ref_one ? result.reference_two : result.reference_one);
+        m_results.push_back(result);
+        emit resultReady(result);
+        return false;
+    }
+    emit message("Morphing: " + ref_one->getImageTitle() + " with " + ref_two->getImageTitle());
+    QElapsedTimer timer;
+    timer.start();
+    FaceImage target;
+    // a grayscale job morphs, filters and encodes a single channel
+    m_image_processor.morphImages(ref_one, ref_two, &target, m_alpha, m_context, m_transform > 0);
+    QImage img = target.getSource();
+    applyFilters(img);
+    m_morph_nsecs += timer.nsecsElapsed();
+    ++m_morphed;
+
+    if(m_ring.isOpen()) {
+        fmg::FrameHeader header = fmg::FrameHeader();
+        header.one = m_indices[one];
+        header.two = m_indices[two];
+        header.alpha = m_alpha;
+        fmg::FrameRing::setLandmarks(header, target.getLandmarks());
+        bool published = m_ring.publish(header, img, m_canceled);
+        if(published) result.path = m_ring_name + "#" + QString::number(m_ring.published() - 1);
+        else result.error = m_ring.errorString();
+        if(!published && !m_canceled) m_ring.close(); // the consumer is gone, see run()
+        m_results.push_back(result);
+        emit resultReady(result);
+        return published;
+    }
+
+    // the encoder saves the result while the next pair is morphed
+    m_encoding.append(result);
+    m_encoder.submit(img, path);
+    return collectEncoded(false);
+}
+
+/**
+ * @brief MorphEngine::collectEncoded
+ *
+ * A private convenience method reporting the results saved by the encoder, in the order
+ * they were morphed, and recording them in the manifest. At most two images per encoder
+ * thread are in flight, the morphs wait for the encoder beyond that, hence the memory of
+ * the pending images is bounded.
+ *
+ * @param wait_all true to wait until every submitted result is saved
+ * @return false if a result could not be saved
+ */
+bool MorphEngine::collectEncoded(bool wait_all)
+{
+    bool saved_all = true;
+    fmg::EncodedImage encoded;
+    int in_flight = 2 * std::max(m_encoder.threads(), 1);
+    while(m_encoder.takeResult(encoded, wait_all || m_encoder.pending() > in_flight)) {
+        MorphResult result = m_encoding.takeFirst();
+        QString name = QFileInfo(encoded.path).fileName();
+        if(encoded.error.isEmpty() && m_archive_size > 0) {
+            if(m_archive.append(name, encoded.data, encoded.digest)) {
+                result.archive = m_archive.fileName();
+                m_archived.insert(name, encoded.digest);
+            } else {
+                encoded.error = m_archive.errorString();
+            }
+        }
+        if(encoded.error.isEmpty()) {
+            result.path = encoded.path;
+            result.digest = QString::fromLatin1(encoded.digest);
+        } else {
+            result.error = encoded.error;
+            saved_all = false;
+        }
+        recordResult(result);
+    }
+    return saved_all;
+}
+
+/**
+ * @brief MorphEngine::morphFrames
+ *
+ * Morphs one pair of encoded images, e.g. of a MorphStream, and applies the configured
+ * filters. An automatic resolution is taken from the first image. Failures are reported by
+ * message().
+ *
+ * @param one the encoded first reference
+ * @param two the encoded second reference
+ * @param index the index of the pair on the stream
+ * @return the filtered morph, null if the pair has no result
+ */
+QImage MorphEngine::morphFrames(const QByteArray &one, const QByteArray &two, int index)
+{
+    FaceImage references[2];
+    const QByteArray *frames[2] = {&one, &two};
+    for(int i = 0; i < 2; ++i) {
+        QBuffer buffer;
+        buffer.setData(*frames[i]); // shared, not copied
+        buffer.open(QIODevice::ReadOnly);
+        QImage decoded = fmg::ImageSource::decodeScaled(&buffer, QSize(m_context.img_width, m_context.img_height));
+        if(!m_context.isValid() && !decoded.isNull()) {
+            // the first image of the stream determines an automatic resolution
+            m_context.img_width = m_image_width != -1 ? m_image_width : decoded.width();
+            m_context.img_height = m_image_height != -1 ? m_image_height : decoded.height();
+            if(decoded.size() != QSize(m_context.img_width, m_context.img_height))
+                decoded = decoded.scaled(m_context.img_width, m_context.img_height,
+                                         Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        QString name = "pair " + QString::number(index) + (i == 0 ? " one" : " two");
+        if(!references[i].setImageSource(name, decoded, m_context)) {
+            emit message("Failed to decode: " + name);
+            return QImage();
+        }
+        std::vector<QPoint> landmarks = m_image_processor.getFacialFeatures(&references[i]);
+        if(landmarks.empty()) {
+            emit message("No face detected: " + name);
+            return QImage();
+        }
+        references[i].setLandmarks(landmarks);
+        if(references[i].hasBadLandmarks(m_context) && !m_allow_bad_morphs) {
+            emit message("Bad landmarks: " + name);
+            return QImage();
+        }
+    }
+    QElapsedTimer timer;
+    timer.start();
+    FaceImage target;
+    m_image_processor.morphImages(&references[0], &references[1], &target, m_alpha, m_context, m_transform > 0);
+    QImage img = target.getSource();
+    applyFilters(img);
+    m_morph_nsecs += timer.nsecsElapsed();
+    ++m_morphed;
+    return img;
+}
+
+/**
+ * @brief MorphEngine::configureEncoder
+ *
+ * Applies the output settings to an encoder, the engine's own or e.g. the one of a
+ * MorphStream.
+ *
+ * @param encoder the encoder
+ */
+void MorphEngine::configureEncoder(fmg::ImageEncoder &encoder) const
+{
+    encoder.setFormat(m_format == 2 ? fmg::ImageEncoder::PNM
+                                    : m_format == 1 ? fmg::ImageEncoder::PNG : fmg::ImageEncoder::JPEG);
+    encoder.setJpegQuality(m_jpeg_quality);
+    encoder.setPngCompression(m_png_compression);
+}
+
+/**
+ * @brief MorphEngine::reportThroughput
+ *
+ * Reports the morph and the encoder throughput since resetRun() separately, the encoder
+ * time is summed over its threads.
+ *
+ * @param encoder the encoder of the run
+ */
+void MorphEngine::reportThroughput(const fmg::ImageEncoder &encoder)
+{
+    if(m_morphed == 0) return;
+    double morph_seconds = m_morph_nsecs / 1e9;
+    double encode_seconds = encoder.encodeSeconds();
+    emit message(QString("Morphed %1 pairs in %2 s, %3 pairs/s")
+                 .arg(m_morphed).arg(morph_seconds, 0, 'f', 2)
+                 .arg(morph_seconds > 0 ? m_morphed / morph_seconds : 0.0, 0, 'f', 2));
+    emit message(QString("Encoded %1 images in %2 s on %3 encoder threads, %4 images/s per thread")
+                 .arg(encoder.encoded()).arg(encode_seconds, 0, 'f', 2).arg(encoder.threads())
+                 .arg(encode_seconds > 0 ? encoder.encoded() / encode_seconds : 0.0, 0, 'f', 2));
+}
+
+/**
+ * @brief MorphEngine::manifestEntry
+ * @param result a saved result
+ * @return the compact json manifest line of the result, without the line break
+ */
+QByteArray MorphEngine::manifestEntry(const MorphResult &result)
+{
+    QJsonObject entry{{"name", QFileInfo(result.path).fileName()},
+                      {"one", result.reference_one},
+                      {"two", result.reference_two},
+                      {"sha1", result.digest}};
+    if(!result.archive.isEmpty()) entry["archive"] = QFileInfo(result.archive).fileName();
+    return QJsonDocument(entry).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief MorphEngine::imagePosition
+ *
+ * Looks up an image registered by registerImages() in the loaded images, the image is
+ * loaded if it was not loaded before.
+ *
+ * @param index the index of the image among the images of the job
+ * @return the position in m_store, -1 if the image could not be loaded
+ */
+int MorphEngine::imagePosition(int index)
+{
+    if(m_positions.contains(index)) return m_positions.value(index);
+    if(index < 0 || index >= m_paths.size()) {
+        fail(INPUT_ERROR, "No image " + QString::number(index) + " in the job");
+        return -1;
+    }
+    const QString &path = m_paths[index];
+    emit message("Loading: " + path);
+    int position = m_store.add(path, fileDigest(path));
+    if(!m_store.image(position)) {
+        m_store.removeLast();
+        fail(LOAD_ERROR, "Failed to load: " + path);
+        return -1;
+    }
+    m_indices.push_back(index);
+    m_positions.insert(index, position);
+    return position;
+}
+
+/**
+ * @brief MorphEngine::ownsPair
+ * @param one the index of an image in m_store
+ * @param two the index of another image in m_store
+ * @return true if the unordered pair belongs to the shard of this engine, see setShard()
+ */
+bool MorphEngine::ownsPair(int one, int two) const
+{
+    return m_shard_count <= 1
+            || shardOf(m_indices[one], m_indices[two]) == m_shard_index;
+}
+
+/**
+ * @brief MorphEngine::isRecorded
+ *
+ * A private convenience method checking whether the output of an ordered pair is recorded
+ * in the manifest and its content still matches, the file or the archive index. A match is
+ * remembered, hence every recorded output is read at most once per run.
+ *
+ * @param one the index of the first reference
+ * @param two the index of the second reference
+ * @return true if the output of the pair is complete
+ */
+bool MorphEngine::isRecorded(int one, int two)
+{
+    QString name = outputName(one, two);
+    if(m_verified.contains(name)) return true;
+    if(!m_completed.contains(name)) return false;
+    QByteArray digest = m_archive_size > 0 ? m_archived.value(name)
+                                           : fileDigest(m_output_directory + "/" + name);
+    if(digest != m_completed.value(name)) return false;
+    m_verified.insert(name);
+    return true;
+}
+
+/**
+ * @brief MorphEngine::isResumed
+ *
+ * A private convenience method checking whether an image is needed by the pending pairs of
+ * a resumed run, see detectLandmarks().
+ *
+ * @param image the index of an image in m_store
+ * @return true if every pair of the image owned by the shard is recorded in both orders
+ */
+bool MorphEngine::isResumed(int image)
+{
+    for(int j = 0; j < m_store.size(); ++j) {
+        if(j == image || !ownsPair(image, j)) continue;
+        if(!isRecorded(image, j) || !isRecorded(j, image)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief MorphEngine::pairBlock
+ *
+ * A private convenience method scheduling the unordered pairs of a block of rows of the
+ * pair matrix, each row image paired with every image before it. The pairs are grouped by
+ * blocks of columns of fmg::ImageStore::blockSize() images, hence the row block and one
+ * column block are resident at a time.
+ *
+ * @param row_begin the first row image
+ * @param row_end the row image past the block
+ * @return the pairs (row image, column image) owned by the shard
+ */
+QList<QPair<int, int>> MorphEngine::pairBlock(int row_begin, int row_end) const
+{
+    int block = m_store.blockSize();
+    QList<QPair<int, int>> pairs;
+    for(int column = 0; column < row_end; column += block) {
+        for(int k = row_begin; k < row_end; ++k) {
+            for(int j = column; j < std::min(column + block, k); ++j) {
+                if(ownsPair(k, j)) pairs.append(qMakePair(k, j));
+            }
+        }
+    }
+    return pairs;
+}
+
+/**
+ * @brief MorphEngine::outputName
+ *
+ * A private convenience method deriving the deterministic output file name of a pair from
+ * the content hashes of both inputs and the settings digest, hence the same pair morphed
+ * with the same settings always maps to the same file.
+ *
+ * @param one the index of the first reference
+ * @param two the index of the second reference
+ * @return the output file name
+ */
+QString MorphEngine::outputName(int one, int two) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_store.digest(one));
+    hash.addData(m_store.digest(two));
+    hash.addData(m_settings_digest);
+    QString key = QString::fromLatin1(hash.result().toHex().left(16));
+    QString title = "(" + m_store.entry(one).getImageTitle() + ")_x_(" + m_store.entry(two).getImageTitle() + ")";
+    return (m_transform > 0 ? "g_" : "") + title + "_" + key + m_encoder.extension(m_transform > 0);
+}
+
+/**
+ * @brief MorphEngine::settingsDigest
+ *
+ * A private convenience method hashing every setting which affects the output pixels.
+ *
+ * @return the hex encoded settings digest
+ */
+QByteArray MorphEngine::settingsDigest() const
+{
+    QJsonObject settings{{"resolution", QJsonArray{m_context.img_width, m_context.img_height}},
+                         {"alpha", m_alpha},
+                         {"h-filter", m_h_filter},
+                         {"g-filter", m_g_filter},
+                         {"m-filter", m_m_filter},
+                         {"b-filter", m_b_filter},
+                         {"transform", m_transform},
+                         {"sharpness", m_sharpness},
+                         {"contrast", m_contrast},
+                         {"brightness", m_brightness},
+                         {"format", m_format},
+                         {"spectral-filter", QJsonArray{(int)m_spectral_mask, m_spectral_cutoff, m_spectral_width}}};
+    // the png compression is lossless, a default jpeg quality keeps the names of earlier runs
+    if(m_format == 0 && m_jpeg_quality >= 0) settings["jpeg-quality"] = m_jpeg_quality;
+    return QCryptographicHash::hash(QJsonDocument(settings).toJson(QJsonDocument::Compact),
+                                    QCryptographicHash::Sha1).toHex();
+}
+
+/**
+ * @brief MorphEngine::fileDigest
+ * @param path a file path
+ * @return the hex encoded sha1 digest of the file content, empty if it can not be read
+ */
+QByteArray MorphEngine::fileDigest(const QString &path)
+{
+    QScopedPointer<QIODevice> file(fmg::ImageSource::open(path));
+    if(!file->isOpen()) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if(!hash.addData(file.data())) return QByteArray();
+    return hash.result().toHex();
+}
+
+/**
+ * @brief MorphEngine::openManifest
+ *
+ * A private convenience method opening the append-only manifest of the output directory,
+ * one json object per completed output. When resuming, the recorded outputs are loaded
+ * first, a line truncated by a crash is ignored. Without setManifestOutput() it only reads
+ * the manifest, the coordinator of the job appends to it.
+ *
+ * @param output_directory the absolute output directory
+ * @return true if the manifest is open for appending
+ */
+bool MorphEngine::openManifest(const QString &output_directory)
+{
+    QString path = output_directory + "/" + MANIFEST_NAME;
+    if(m_shard_count > 1) {
+        // the shards may share an output directory, each appends to its own manifest
+        path = output_directory + "/manifest.shard-" + QString::number(m_shard_index)
+                + "-of-" + QString::number(m_shard_count) + ".jsonl";
+    }
+    if(m_manifest.fileName() == path && (m_manifest.isOpen() || !m_write_manifest)) return true;
+    m_manifest.close();
+    m_completed.clear();
+    m_verified.clear();
+    m_manifest.setFileName(path);
+    if(m_resume && m_manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while(!m_manifest.atEnd()) {
+            QJsonObject entry = QJsonDocument::fromJson(m_manifest.readLine()).object();
+            if(entry.contains("name")) m_completed.insert(entry["name"].toString(), entry["sha1"].toString().toLatin1());
+        }
+        m_manifest.close();
+        emit message("Resuming, " + QString::number(m_completed.size()) + " outputs recorded in: " + path);
+    }
+    m_archived.clear();
+    if(m_resume && m_archive_size > 0) {
+        // a recorded output is only complete if its content made it into an archive
+        QHash<QString, fmg::ResultArchive::Entry> entries = fmg::ResultArchive::readIndices(output_directory);
+        for(auto it = entries.constBegin(); it != entries.constEnd(); ++it) m_archived.insert(it.key(), it.value().digest);
+    }
+    if(!m_write_manifest) return true;
+    return m_manifest.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+/**
+ * @brief MorphEngine::archivePrefix
+ * @return the file name prefix of the archive shards, distinct per shard of the job
+ */
+QString MorphEngine::archivePrefix() const
+{
+    if(m_shard_count == 1) return ARCHIVE_PREFIX;
+    return QString(ARCHIVE_PREFIX) + ".shard-" + QString::number(m_shard_index) + "-of-" + QString::number(m_shard_count);
+}
+
+/**
+ * @brief MorphEngine::detectLandmarks
+ *
+ * Detects the landmarks of every image added since the last run() which has none yet.
+ * Images in which no face is detected keep an empty landmark set and are skipped by run().
+ * With setResume() an image whose pairs are all recorded in both orders is neither decoded
+ * nor detected, its detection is deferred until a later run adds a pair it lacks.
+ *
+ */
+void MorphEngine::detectLandmarks()
+{
+    // the images from m_processed on are visited anyway, also if an earlier run was canceled
+    QList<int> pending;
+    for(int i : m_deferred) {
+        if(i < m_processed) pending.append(i);
+    }
+    m_deferred.clear();
+    for(int i = m_processed; i < m_store.size(); ++i) pending.append(i);
+    for(int i : pending) {
+        if(m_canceled) {
+            if(i < m_processed) m_deferred.append(i);
+            continue;
+        }
+        if(m_store.entry(i).hasLandmarks()) continue;
+        if(m_resume && isResumed(i)) {
+            m_deferred.append(i);
+            continue;
+        }
+        FaceImage *img = m_store.image(i);
+        if(!img) {
+            emit message("Failed to load: " + m_store.path(i));
+            continue;
+        }
+        std::vector<QPoint> landmarks = m_image_processor.getFacialFeatures(img);
+        if(landmarks.empty()) {
+            emit message("No face detected: " + img->getImageTitle());
+            continue;
+        }
+        img->setLandmarks(landmarks);
+    }
+}
+
+/**
+ * @brief MorphEngine::detectLandmarks
+ *
+ * Detects the landmarks of a registered image, see registerImages(). An image in which no
+ * face is detected keeps an empty landmark set.
+ *
+ * @param index the index of the image among the images of the job
+ * @param landmarks the detected landmarks, empty if no face was detected
+ * @return false if the image could not be loaded, see error()
+ */
+bool MorphEngine::detectLandmarks(int index, std::vector<QPoint> &landmarks)
+{
+    int position = imagePosition(index);
+    FaceImage *image = position < 0 ? nullptr : m_store.image(position);
+    if(!image) {
+        if(position >= 0) fail(LOAD_ERROR, "Failed to load: " + m_store.path(position));
+        return false;
+    }
+    landmarks = m_image_processor.getFacialFeatures(image);
+    if(landmarks.empty()) emit message("No face detected: " + image->getImageTitle());
+    else image->setLandmarks(landmarks);
+    return true;
+}
+
+/**
+ * @brief MorphEngine::setLandmarks
+ *
+ * Sets the landmarks of a registered image which were detected before, possibly by another
+ * engine, an image which has landmarks keeps them.
+ *
+ * @param index the index of the image among the images of the job
+ * @param landmarks the landmarks
+ * @return false if the image could not be loaded, see error()
+ */
+bool MorphEngine::setLandmarks(int index, const std::vector<QPoint> &landmarks)
+{
+    int position = imagePosition(index);
+    if(position < 0) return false;
+    if(m_store.entry(position).hasLandmarks()) return true;
+    FaceImage *image = m_store.image(position); // the extra landmarks need the image size
+    if(!image) return fail(LOAD_ERROR, "Failed to load: " + m_store.path(position));
+    image->setLandmarks(landmarks);
+    return true;
+}
+
+/**
+ * @brief MorphEngine::applyFilters
+ *
+ * A private convenience method to apply the configured post-processing routines.
+ *
+ * @param img the image which the filters will be applied to.
+ */
+void MorphEngine::applyFilters(QImage &img)
+{
+    if(img.isNull()) return;
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::BRIGHTNESS,
+                                  m_brightness);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::CONTRAST,
+                                  m_contrast);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::SHARPNESS,
+                                  m_sharpness);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::BILATERAL,
+                                  m_b_filter);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::MEDIAN,
+                                  m_m_filter);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::GAUSSIAN,
+                                  m_g_filter);
+    m_image_processor.applyFilter(img,
+                                  ImageProcessor::Filter::HOMOGENEOUS,
+                                  m_h_filter);
+    m_image_processor.spectralFilter(img,
+                                     m_spectral_mask,
+                                     m_spectral_cutoff,
+                                     m_spectral_width);
+}
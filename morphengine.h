@@ -0,0 +1,196 @@
+#pragma once
+#include <QObject>
+
+#include "imageprocessor.h"
+#include "faceimage.h"
+#include "framering.h"
+#include "imageencoder.h"
+#include "imagestore.h"
+#include "resultarchive.h"
+#include "morphcontext.h"
+
+#include <atomic>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QPoint>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The MorphResult struct
+ * The outcome of morphing one ordered pair of input images.
+ */
+struct MorphResult
+{
+    QString reference_one;
+    QString reference_two;
+    QString path;   // the saved output file, or its name within archive, empty if saving failed
+    QString error;  // empty on success
+    QString digest; // the hex encoded sha1 of the saved file
+    QString archive; // the ResultArchive shard holding the output, empty if saved as a file
+};
+Q_DECLARE_METATYPE(MorphResult)
+
+/**
+ * @brief The MorphEngine class
+ *
+ * The reusable batch morphing engine. A job is described by configure(), addImages() and
+ * run(), the outcome is available from results() and error(). The resolution of the job
+ * is held by the engine's own fmg::MorphContext and the shape predictor is shared by the
+ * process, hence independent engines may run concurrently in separate threads, and several
+ * jobs can be run by one engine after clear(). Images added between two runs are morphed
+ * incrementally, see run().
+ * cancel() may be invoked from any thread, the running job stops after the current pair.
+ *
+ * The other run modes drive the engine through the steps run() is made of, from
+ * resetRun() to endRun() or failRun(), see MorphPreforker, MorphStream and
+ * MorphBatchRunner.
+ */
+class MorphEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphEngine(QObject *parent = nullptr);
+    ~MorphEngine() = default;
+
+    enum Error {
+        NONE, SETTINGS_ERROR, INPUT_ERROR, LOAD_ERROR, OUTPUT_ERROR, CANCELED
+    };
+
+signals:
+    void message(const QString &text);
+    void progress(int done, int total);
+    void resultReady(const MorphResult &result);
+    void finished(bool ok, const QString &error);
+
+public slots:
+    void runJob(const QJsonObject &job);
+
+public:
+    bool configure(const QString &json_path);
+    bool configure(const QJsonObject &settings);
+    void resetSettings();
+    bool addImages(const QString &input_dir);
+    bool addImages(const QStringList &paths);
+    bool registerImages(const QStringList &paths);
+    bool run(const QString &output_dir);
+    void cancel();
+    bool isCanceled() const;
+    void setResume(bool resume);
+    void setCacheDirectory(const QString &directory);
+    void setMemoryBudget(qint64 bytes);
+    void setEncoderThreads(int threads);
+    void setArchiveOutput(qint64 shard_size);
+    void setSharedMemoryOutput(const QString &name, int slot_count, int timeout_msecs);
+    bool hasSharedMemoryOutput() const;
+    void setManifestOutput(bool write);
+    bool setShard(int index, int count);
+    bool mergeManifests(const QString &output_dir);
+    static QByteArray manifestEntry(const MorphResult &result);
+    void configureEncoder(fmg::ImageEncoder &encoder) const;
+    void clear();
+
+    void resetRun();
+    bool beginRun(const QString &output_dir);
+    bool openOutput(const QString &archive_suffix = QString());
+    void detectLandmarks();
+    bool detectLandmarks(int index, std::vector<QPoint> &landmarks);
+    bool setLandmarks(int index, const std::vector<QPoint> &landmarks);
+    int imagePosition(int index);
+    QList<QPair<int, int>> pendingPairs() const;
+    bool morphPair(int one, int two);
+    QImage morphFrames(const QByteArray &one, const QByteArray &two, int index);
+    void recordResult(const MorphResult &result);
+    std::vector<MorphResult> takeResults();
+    bool endRun(bool saved_all);
+    bool failRun(Error error, const QString &text);
+    void reportThroughput(const fmg::ImageEncoder &encoder);
+
+    const std::vector<MorphResult> &results() const;
+    Error error() const;
+    QString errorString() const;
+
+private:
+    bool fail(Error error, const QString &text);
+    bool resolveResolution(const QStringList &paths);
+    bool planShards(int images);
+    std::vector<bool> shardImages(int images) const;
+    int shardOf(int one, int two) const;
+    static int shardBlocks(int shards);
+    static std::vector<int> assignShards(const std::vector<qint64> &pairs, int shards);
+    bool ownsPair(int one, int two) const;
+    bool isRecorded(int one, int two);
+    bool isResumed(int image);
+    QList<QPair<int, int>> pairBlock(int row_begin, int row_end) const;
+    bool collectEncoded(bool wait_all);
+    QString outputName(int one, int two) const;
+    QByteArray settingsDigest() const;
+    static QByteArray fileDigest(const QString &path);
+    bool openManifest(const QString &output_directory);
+    QString archivePrefix() const;
+    void applyFilters(QImage &img);
+
+private:
+    int m_image_width;
+    int m_image_height;
+    float m_alpha;
+    int m_h_filter;
+    int m_g_filter;
+    int m_m_filter;
+    int m_b_filter;
+    int m_transform;
+    int m_sharpness;
+    int m_contrast;
+    int m_brightness;
+    bool m_allow_bad_morphs;
+    int m_format;
+    int m_jpeg_quality;
+    int m_png_compression;
+    ImageProcessor::SpectralMask m_spectral_mask;
+    float m_spectral_cutoff;
+    float m_spectral_width;
+
+private:
+    ImageProcessor m_image_processor;
+    fmg::MorphContext m_context;
+    fmg::ImageStore m_store; // the loaded images, their content digests are the output keys
+    std::vector<int> m_indices; // the indices of m_store among all images of the job
+    int m_image_count; // all images of the job, including those not loaded by the shard
+    int m_shard_index;
+    int m_shard_count;
+    int m_shard_blocks;
+    std::vector<int> m_shard_table; // the shard of every block pair, see planShards()
+    QStringList m_paths; // the images registered by registerImages()
+    QHash<int, int> m_positions; // the image indices of the job -> m_store
+    QString m_output_directory;
+    std::vector<MorphResult> m_results;
+    fmg::ImageEncoder m_encoder;
+    QList<MorphResult> m_encoding; // the results submitted to m_encoder, in submission order
+    qint64 m_morph_nsecs; // the time spent morphing and filtering since resetRun()
+    int m_morphed;
+    int m_processed; // the first m_processed images were morphed with each other
+    bool m_resume;
+    bool m_write_manifest;
+    QByteArray m_settings_digest;
+    QFile m_manifest;
+    QHash<QString, QByteArray> m_completed; // output file name -> content digest
+    QSet<QString> m_verified; // the outputs of m_completed whose content matched, see isRecorded()
+    QList<int> m_deferred; // the images of m_store not detected yet as their pairs were recorded
+    qint64 m_archive_size; // the shard size of the archive output, 0 to write files
+    fmg::ResultArchive m_archive;
+    QHash<QString, QByteArray> m_archived; // output file name -> digest, in the indices of the archives
+    QString m_ring_name; // the shared memory of the raw output, empty to encode the results
+    int m_ring_slots;
+    int m_ring_timeout; // msecs the run waits for the consumer of a full ring
+    fmg::FrameRing m_ring;
+    std::atomic<bool> m_canceled;
+    Error m_error;
+    QString m_error_string;
+};
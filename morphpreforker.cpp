@@ -0,0 +1,292 @@
+#include "morphpreforker.h"
+
+#include "imageprocessor.h"
+#include "morphengine.h"
+#include "morphservice.h"
+
+#include <QDebug>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @brief writeFully
+ * @return true if every byte was written to the file descriptor
+ */
+static bool writeFully(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char*>(data);
+    while(size > 0) {
+        ssize_t count = write(fd, bytes, size);
+        if(count < 0 && errno == EINTR) continue;
+        if(count <= 0) return false;
+        bytes += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * @brief readFully
+ * @return true if every byte was read from the file descriptor, false at its end
+ */
+static bool readFully(int fd, void *data, size_t size)
+{
+    char *bytes = static_cast<char*>(data);
+    while(size > 0) {
+        ssize_t count = read(fd, bytes, size);
+        if(count < 0 && errno == EINTR) continue;
+        if(count <= 0) return false;
+        bytes += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+#endif
+
+/**
+ * @brief MorphPreforker::MorphPreforker
+ * @param engine the configured engine holding the images of the job
+ * @param parent the Qt parent
+ */
+MorphPreforker::MorphPreforker(MorphEngine *engine, QObject *parent) :
+    QObject(parent),
+    m_engine(engine)
+{
+}
+
+/**
+ * @brief MorphPreforker::run
+ *
+ * Runs the job in the worker processes. The OpenCV routines run sequentially while the
+ * workers run, since they already occupy the cores and a forked process must not rely on
+ * the thread pool of its parent, and SIGPIPE is ignored. Both are restored before
+ * returning. With a single process, a shared memory output, which has a single producer,
+ * or on systems without fork() the job is run by MorphEngine::run().
+ *
+ * @param output_dir a directory path to the output images
+ * @param processes the amount of worker processes
+ * @return true if every result was saved, false on cancellation or failure, see
+ * MorphEngine::error()
+ */
+bool MorphPreforker::run(const QString &output_dir, int processes)
+{
+#ifndef Q_OS_UNIX
+    Q_UNUSED(processes);
+    emit message("Worker processes require fork(), running in this process");
+    return m_engine->run(output_dir);
+#else
+    if(processes <= 1) return m_engine->run(output_dir);
+    if(m_engine->hasSharedMemoryOutput()) {
+        emit message("The shared memory output has a single producer, running in this process");
+        return m_engine->run(output_dir);
+    }
+    m_engine->resetRun();
+    if(!m_engine->beginRun(output_dir)) return false;
+
+    // OpenCV must not run threads across fork(), and a dead worker is detected by its closed
+    // pipe instead of SIGPIPE, the process wide settings are restored on every return
+    struct ForkState {
+        int threads;
+        void (*sigpipe)(int);
+        ForkState() : threads(ImageProcessor::parallelThreads()), sigpipe(std::signal(SIGPIPE, SIG_IGN))
+        {
+            ImageProcessor::setParallelThreads(0);
+        }
+        ~ForkState() { restore(); }
+        void restore()
+        {
+            if(threads < 0) return;
+            ImageProcessor::setParallelThreads(threads);
+            if(sigpipe != SIG_ERR) std::signal(SIGPIPE, sigpipe);
+            threads = -1;
+        }
+    } fork_state;
+    m_engine->detectLandmarks();
+    if(m_engine->isCanceled()) return m_engine->failRun(MorphEngine::CANCELED, "Canceled");
+
+    // an assignment is an unordered pair, the worker morphs it in both orders, in the blocked
+    // order of run(), such that the images decoded by a worker are reused by its next pairs
+    QList<QPair<int, int>> pending = m_engine->pendingPairs();
+    int total = pending.size() * 2;
+
+    struct Worker {
+        pid_t pid;
+        int assign_fd;
+        int result_fd;
+        QByteArray buffer;
+        QList<QPair<int, int>> assigned;
+    };
+    std::vector<Worker> workers;
+    for(int i = 0; i < processes; ++i) {
+        int assign[2];
+        int result[2];
+        if(pipe(assign) != 0) break;
+        if(pipe(result) != 0) {
+            close(assign[0]);
+            close(assign[1]);
+            break;
+        }
+        pid_t pid = fork();
+        if(pid < 0) {
+            close(assign[0]);
+            close(assign[1]);
+            close(result[0]);
+            close(result[1]);
+            break;
+        }
+        if(pid == 0) {
+            close(assign[1]);
+            close(result[0]);
+            for(const Worker &sibling : workers) {
+                close(sibling.assign_fd);
+                close(sibling.result_fd);
+            }
+            workerProcess(assign[0], result[1], i); // does not return
+        }
+        close(assign[0]);
+        close(result[1]);
+        workers.push_back(Worker{pid, assign[1], result[0], QByteArray(), QList<QPair<int, int>>()});
+    }
+    if(workers.empty()) {
+        emit message("Unable to fork worker processes, running in this process");
+        fork_state.restore();
+        return m_engine->run(output_dir);
+    }
+    emit message("Morphing " + QString::number(total) + " pairs in " + QString::number(workers.size()) + " worker processes");
+
+    int done = 0;
+    bool saved_all = true;
+    while(true) {
+        // keep two assignments in flight per worker, such that no worker waits for this process
+        bool busy = false;
+        for(Worker &worker : workers) {
+            while(worker.assign_fd >= 0 && worker.assigned.size() < 2 && !pending.isEmpty() && !m_engine->isCanceled()) {
+                qint32 record[2] = {pending.first().first, pending.first().second};
+                if(!writeFully(worker.assign_fd, record, sizeof(record))) break;
+                worker.assigned.append(pending.takeFirst());
+            }
+            busy = busy || !worker.assigned.isEmpty();
+        }
+        if(!busy) break;
+
+        std::vector<pollfd> fds;
+        std::vector<Worker*> polled;
+        for(Worker &worker : workers) {
+            if(worker.result_fd < 0) continue;
+            fds.push_back(pollfd{worker.result_fd, POLLIN, 0});
+            polled.push_back(&worker);
+        }
+        if(poll(fds.data(), (nfds_t)fds.size(), -1) < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        for(size_t i = 0; i < fds.size(); ++i) {
+            if(fds[i].revents == 0) continue;
+            Worker &worker = *polled[i];
+            char buffer[65536];
+            ssize_t count = read(worker.result_fd, buffer, sizeof(buffer));
+            if(count < 0 && errno == EINTR) continue;
+            if(count <= 0) {
+                emit message("Worker process " + QString::number(worker.pid) + " died, reassigning "
+                             + QString::number(worker.assigned.size()) + " pairs");
+                close(worker.result_fd);
+                close(worker.assign_fd);
+                worker.result_fd = -1;
+                worker.assign_fd = -1;
+                pending = worker.assigned + pending;
+                worker.assigned.clear();
+                continue;
+            }
+            worker.buffer.append(buffer, (int)count);
+            QJsonObject frame;
+            while(MorphService::nextFrame(worker.buffer, frame)) {
+                if(frame["type"].toString() == "complete") {
+                    if(!worker.assigned.isEmpty()) worker.assigned.removeFirst();
+                    done += 2;
+                    emit progress(done, total);
+                    continue;
+                }
+                MorphResult result;
+                result.reference_one = frame["one"].toString();
+                result.reference_two = frame["two"].toString();
+                result.path = frame["path"].toString();
+                result.error = frame["error"].toString();
+                result.digest = frame["sha1"].toString();
+                result.archive = frame["archive"].toString();
+                saved_all = result.error.isEmpty() && saved_all;
+                m_engine->recordResult(result);
+            }
+        }
+    }
+
+    // the workers exit once their assignment pipe is closed
+    for(Worker &worker : workers) {
+        if(worker.assign_fd >= 0) close(worker.assign_fd);
+    }
+    for(Worker &worker : workers) {
+        waitpid(worker.pid, nullptr, 0);
+        if(worker.result_fd >= 0) close(worker.result_fd);
+    }
+    if(m_engine->isCanceled()) return m_engine->failRun(MorphEngine::CANCELED, "Canceled");
+    if(!pending.isEmpty())
+        return m_engine->failRun(MorphEngine::OUTPUT_ERROR, "The worker processes died, "
+                                 + QString::number(pending.size() * 2) + " pairs were not morphed");
+    return m_engine->endRun(saved_all);
+#endif
+}
+
+#ifdef Q_OS_UNIX
+/**
+ * @brief MorphPreforker::workerProcess
+ *
+ * The loop of a forked worker process, morphs the assigned pairs in both orders and reports
+ * the results, followed by a "complete" frame per assignment. The worker exits once the
+ * assignment pipe is closed. Signals are blocked, the receivers live in the parent
+ * process. With an archive output every worker appends to archives of its own, named
+ * after its slot, such that a later run continues them.
+ *
+ * @param assign_fd the read end of the assignment pipe
+ * @param result_fd the write end of the result pipe
+ * @param slot the index of the worker among the workers of the run
+ */
+void MorphPreforker::workerProcess(int assign_fd, int result_fd, int slot)
+{
+    blockSignals(true);
+    m_engine->blockSignals(true);
+    m_engine->setManifestOutput(false); // the parent records the results
+    m_engine->setEncoderThreads(0); // the encoder threads of the parent do not exist here
+    m_engine->takeResults(); // the results of the parent
+    if(!m_engine->openOutput(".worker-" + QString::number(slot)))
+        qWarning().noquote() << m_engine->errorString(); // every result then reports the failure
+    qint32 record[2];
+    while(readFully(assign_fd, record, sizeof(record))) {
+        for(int order = 0; order < 2; ++order) {
+            m_engine->morphPair(record[order], record[1 - order]);
+            for(const MorphResult &result : m_engine->takeResults()) {
+                QByteArray frame = MorphService::frame(QJsonObject{{"type", "result"},
+                                                                   {"one", result.reference_one},
+                                                                   {"two", result.reference_two},
+                                                                   {"path", result.path},
+                                                                   {"error", result.error},
+                                                                   {"sha1", result.digest},
+                                                                   {"archive", result.archive}});
+                if(!writeFully(result_fd, frame.constData(), (size_t)frame.size())) _exit(1);
+            }
+        }
+        QByteArray frame = MorphService::frame(QJsonObject{{"type", "complete"}});
+        if(!writeFully(result_fd, frame.constData(), (size_t)frame.size())) _exit(1);
+    }
+    m_engine->endRun(true);
+    _exit(0);
+}
+#endif
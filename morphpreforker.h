@@ -0,0 +1,41 @@
+#pragma once
+#include <QObject>
+
+#include <QString>
+
+class MorphEngine;
+/**
+ * @brief The MorphPreforker class
+ *
+ * Runs the job of a MorphEngine like MorphEngine::run(), morphing the pairs in several
+ * worker processes. Everything the workers share is prepared in this process before
+ * forking, the shape predictor was loaded by the engine, the images were decoded by
+ * MorphEngine::addImages() and the landmarks are detected here. The forked workers share
+ * these pages copy-on-write, hence the memory grows with the decoded images plus the
+ * scratch memory of each worker, rather than with a model per worker. With a memory budget
+ * every worker decodes the images it needs within its own budget instead.
+ *
+ * The pairs are assigned through pipes, two at a time per worker, and the results are
+ * reported back through pipes, the manifest is written by this process only. The
+ * assignments of a worker which dies are given to the remaining workers.
+ */
+class MorphPreforker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphPreforker(MorphEngine *engine, QObject *parent = nullptr);
+
+    bool run(const QString &output_dir, int processes);
+
+signals:
+    void message(const QString &text);
+    void progress(int done, int total);
+
+private:
+#ifdef Q_OS_UNIX
+    void workerProcess(int assign_fd, int result_fd, int slot);
+#endif
+
+private:
+    MorphEngine *m_engine;
+};
@@ -0,0 +1,312 @@
+#include "morphservice.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtEndian>
+
+#define MAX_FRAME_SIZE (16 * 1024 * 1024)
+
+/**
+ * @brief MorphService::MorphService
+ *
+ * The MorphService ctor, constructs the resident MorphEngine and starts its worker thread,
+ * the shape predictor is loaded once, here.
+ *
+ * @param parent the Qt parent
+ */
+MorphService::MorphService(QObject *parent) :
+    QObject(parent),
+    m_server(new QLocalServer(this)),
+    m_engine(new MorphEngine),
+    m_busy(false)
+{
+    m_engine->moveToThread(&m_worker);
+    connect(&m_worker, SIGNAL(finished()),
+            m_engine, SLOT(deleteLater()));
+
+    connect(m_engine, SIGNAL(message(QString)),
+            this, SLOT(engineMessage(QString)));
+
+    connect(m_engine, SIGNAL(resultReady(MorphResult)),
+            this, SLOT(engineResult(MorphResult)));
+
+    connect(m_engine, SIGNAL(finished(bool, QString)),
+            this, SLOT(engineFinished(bool, QString)));
+
+    connect(m_server, SIGNAL(newConnection()),
+            this, SLOT(newConnection()));
+
+    m_worker.start();
+}
+
+/**
+ * @brief MorphService::~MorphService
+ *
+ * Cancels the running job and stops the worker thread.
+ *
+ */
+MorphService::~MorphService()
+{
+    m_engine->cancel();
+    m_worker.quit();
+    m_worker.wait();
+}
+
+/**
+ * @brief MorphService::listen
+ *
+ * Starts listening on the local socket name, a stale socket left behind by a crashed
+ * daemon is removed first.
+ *
+ * @param name the local socket name or path
+ * @return true if the service is listening
+ */
+bool MorphService::listen(const QString &name)
+{
+    QLocalServer::removeServer(name);
+    return m_server->listen(name);
+}
+
+/**
+ * @brief MorphService::errorString
+ * @return the description of the last server error
+ */
+QString MorphService::errorString() const
+{
+    return m_server->errorString();
+}
+
+/**
+ * @brief MorphService::frame
+ * @param object the json object
+ * @return the length-prefixed frame of the json object
+ */
+QByteArray MorphService::frame(const QJsonObject &object)
+{
+    QByteArray payload = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    QByteArray result(4, 0);
+    qToBigEndian<quint32>((quint32)payload.size(), reinterpret_cast<uchar*>(result.data()));
+    return result + payload;
+}
+
+/**
+ * @brief MorphService::nextFrame
+ *
+ * Removes the next complete frame from the buffer of received bytes.
+ *
+ * @param buffer the received bytes
+ * @param object the json object of the frame
+ * @param malformed set to true if the buffer does not contain a valid frame
+ * @return true if a complete frame was removed from the buffer
+ */
+bool MorphService::nextFrame(QByteArray &buffer, QJsonObject &object, bool *malformed)
+{
+    if(malformed) *malformed = false;
+    if(buffer.size() < 4) return false;
+    quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+    if(size > MAX_FRAME_SIZE) {
+        if(malformed) *malformed = true;
+        return false;
+    }
+    if((quint32)buffer.size() < 4 + size) return false;
+    QJsonDocument document = QJsonDocument::fromJson(buffer.mid(4, (int)size));
+    buffer.remove(0, 4 + (int)size);
+    if(!document.isObject()) {
+        if(malformed) *malformed = true;
+        return false;
+    }
+    object = document.object();
+    return true;
+}
+
+/**
+ * @brief MorphService::submit
+ *
+ * The client side of the protocol, submits a job to the daemon listening on the local
+ * socket name and prints the streamed messages and results until the job is done.
+ *
+ * @param name the local socket name or path
+ * @param job the job request, see MorphEngine::runJob
+ * @return the process exit code, 0 if the job succeeded
+ */
+int MorphService::submit(const QString &name, const QJsonObject &job)
+{
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if(!socket.waitForConnected(5000)) {
+        qWarning().noquote() << "Unable to connect to the morph service:" << socket.errorString();
+        return 1;
+    }
+    QJsonObject request = job;
+    request["type"] = "job";
+    socket.write(frame(request));
+    socket.flush();
+
+    QByteArray buffer;
+    while(socket.waitForReadyRead(-1)) {
+        buffer += socket.readAll();
+        QJsonObject response;
+        while(nextFrame(buffer, response)) {
+            QString type = response["type"].toString();
+            if(type == "message") {
+                qDebug().noquote() << response["text"].toString();
+            } else if(type == "result") {
+                if(response["error"].toString().isEmpty())
+                    qDebug().noquote() << "Saved:" << response["path"].toString();
+                else qWarning().noquote() << response["error"].toString();
+            } else if(type == "done") {
+                if(!response["ok"].toBool()) {
+                    qWarning().noquote() << response["error"].toString();
+                    return 1;
+                }
+                return 0;
+            }
+        }
+    }
+    qWarning() << "The morph service closed the connection";
+    return 1;
+}
+
+/**
+ * @brief MorphService::newConnection
+ *
+ * A private SLOT invoked when a client connects.
+ *
+ */
+void MorphService::newConnection()
+{
+    while(QLocalSocket *client = m_server->nextPendingConnection()) {
+        m_buffers.insert(client, QByteArray());
+        connect(client, SIGNAL(readyRead()),
+                this, SLOT(readRequests()));
+        connect(client, SIGNAL(disconnected()),
+                this, SLOT(clientDisconnected()));
+    }
+}
+
+/**
+ * @brief MorphService::readRequests
+ *
+ * A private SLOT invoked when a client sent data, complete frames are dispatched. A client
+ * sending a malformed frame is disconnected.
+ *
+ */
+void MorphService::readRequests()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+    QByteArray &buffer = m_buffers[client];
+    buffer += client->readAll();
+    QJsonObject request;
+    bool malformed = false;
+    while(nextFrame(buffer, request, &malformed)) {
+        QString type = request["type"].toString();
+        if(type == "job") {
+            m_queue.enqueue(Job{client, request});
+            send(client, QJsonObject{{"type", "message"},
+                                     {"text", "Queued job, position " + QString::number(m_queue.size())}});
+        } else if(type == "cancel") {
+            if(client == m_active_client) m_engine->cancel();
+        } else {
+            send(client, QJsonObject{{"type", "message"}, {"text", "Unknown request: " + type}});
+        }
+    }
+    if(malformed) {
+        qWarning() << "Malformed request, closing the connection";
+        client->disconnectFromServer();
+        return;
+    }
+    startNextJob();
+}
+
+/**
+ * @brief MorphService::clientDisconnected
+ *
+ * A private SLOT invoked when a client disconnects, its running job is canceled and its
+ * queued jobs are dropped.
+ *
+ */
+void MorphService::clientDisconnected()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+    if(client == m_active_client) m_engine->cancel();
+    for(auto it = m_queue.begin(); it != m_queue.end();) {
+        if(it->client == client) it = m_queue.erase(it);
+        else ++it;
+    }
+    m_buffers.remove(client);
+    client->deleteLater();
+}
+
+/**
+ * @brief MorphService::engineMessage
+ * @param text a progress message of the running job
+ */
+void MorphService::engineMessage(const QString &text)
+{
+    send(m_active_client, QJsonObject{{"type", "message"}, {"text", text}});
+}
+
+/**
+ * @brief MorphService::engineResult
+ * @param result a result of the running job
+ */
+void MorphService::engineResult(const MorphResult &result)
+{
+    send(m_active_client, QJsonObject{{"type", "result"},
+                                      {"one", result.reference_one},
+                                      {"two", result.reference_two},
+                                      {"path", result.path},
+                                      {"error", result.error},
+                                      {"archive", result.archive}});
+}
+
+/**
+ * @brief MorphService::engineFinished
+ *
+ * A private SLOT invoked when the running job finished, the next queued job is started.
+ *
+ * @param ok true if the job succeeded
+ * @param error the description of the failure
+ */
+void MorphService::engineFinished(bool ok, const QString &error)
+{
+    send(m_active_client, QJsonObject{{"type", "done"}, {"ok", ok}, {"error", error}});
+    m_active_client = nullptr;
+    m_busy = false;
+    startNextJob();
+}
+
+/**
+ * @brief MorphService::startNextJob
+ *
+ * A private convenience method dispatching the next queued job to the worker thread.
+ *
+ */
+void MorphService::startNextJob()
+{
+    if(m_busy || m_queue.isEmpty()) return;
+    Job job = m_queue.dequeue();
+    if(!job.client) {
+        startNextJob();
+        return;
+    }
+    m_busy = true;
+    m_active_client = job.client;
+    QMetaObject::invokeMethod(m_engine, "runJob", Qt::QueuedConnection,
+                              Q_ARG(QJsonObject, job.request));
+}
+
+/**
+ * @brief MorphService::send
+ * @param client the receiving client, ignored if disconnected
+ * @param object the json object to be sent
+ */
+void MorphService::send(QLocalSocket *client, const QJsonObject &object)
+{
+    if(!client || client->state() != QLocalSocket::ConnectedState) return;
+    client->write(frame(object));
+}
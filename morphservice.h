@@ -0,0 +1,75 @@
+#pragma once
+#include <QObject>
+
+#include "morphengine.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QPointer>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+
+class QLocalServer;
+class QLocalSocket;
+/**
+ * @brief The MorphService class
+ *
+ * The long-lived morph daemon. A resident MorphEngine, running in a worker thread, keeps
+ * the shape predictor and its caches loaded between jobs. Clients connect through a local
+ * socket (QLocalServer) and exchange frames, a frame is a 32-bit big-endian length followed
+ * by a compact UTF-8 json object.
+ *
+ * Requests:
+ *   {"type": "job", "input": dir, "output": dir, "settings": {...}}   see MorphEngine::runJob
+ *   {"type": "cancel"}                                                cancels the client's job
+ *
+ * Responses, streamed while the job runs:
+ *   {"type": "message", "text": ...}
+ *   {"type": "result", "one": path, "two": path, "path": path, "error": text, "archive": shard}
+ *   {"type": "done", "ok": bool, "error": text}
+ *
+ * Jobs are queued and run one at a time, in the order they were received.
+ */
+class MorphService : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphService(QObject *parent = nullptr);
+    ~MorphService();
+
+    bool listen(const QString &name);
+    QString errorString() const;
+
+    static QByteArray frame(const QJsonObject &object);
+    static bool nextFrame(QByteArray &buffer, QJsonObject &object, bool *malformed = nullptr);
+    static int submit(const QString &name, const QJsonObject &job);
+
+private slots:
+    void newConnection();
+    void readRequests();
+    void clientDisconnected();
+    void engineMessage(const QString &text);
+    void engineResult(const MorphResult &result);
+    void engineFinished(bool ok, const QString &error);
+
+private:
+    struct Job {
+        QPointer<QLocalSocket> client;
+        QJsonObject request;
+    };
+
+    void startNextJob();
+    void send(QLocalSocket *client, const QJsonObject &object);
+
+private:
+    QLocalServer *m_server;
+    QThread m_worker;
+    MorphEngine *m_engine;
+
+    QHash<QLocalSocket*, QByteArray> m_buffers;
+    QQueue<Job> m_queue;
+    QPointer<QLocalSocket> m_active_client;
+    bool m_busy;
+};
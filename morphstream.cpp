@@ -0,0 +1,165 @@
+#include "morphstream.h"
+
+#include "morphengine.h"
+
+#include <algorithm>
+#include <QFileDevice>
+#include <QIODevice>
+#include <QtEndian>
+
+#ifdef Q_OS_UNIX
+#include <poll.h>
+#endif
+
+#define MAX_STREAM_FRAME (256*1024*1024) // bytes of an encoded image on the stream
+
+/**
+ * @brief readStreamFrame
+ * @param device the input of the stream
+ * @param frame the content of the frame
+ * @param size set to the announced size of the frame, -1 if the input ended before it
+ * @param received set to the bytes of the frame read, its length included, 0 if the input
+ * ended cleanly before the frame
+ * @return true if a complete frame was read
+ */
+static bool readStreamFrame(QIODevice *device, QByteArray &frame, qint64 &size, qint64 &received)
+{
+    size = -1;
+    received = 0;
+    uchar prefix[4];
+    while(received < 4) {
+        qint64 count = device->read(reinterpret_cast<char*>(prefix) + received, 4 - received);
+        if(count < 0 || (count == 0 && !device->waitForReadyRead(-1))) return false;
+        received += count;
+    }
+    size = qFromBigEndian<quint32>(prefix);
+    if(size > MAX_STREAM_FRAME) return false;
+    frame.resize((int)size);
+    for(qint64 done = 0; done < size;) {
+        qint64 count = device->read(frame.data() + done, size - done);
+        if(count < 0 || (count == 0 && !device->waitForReadyRead(-1))) return false;
+        done += count;
+        received += count;
+    }
+    return true;
+}
+
+/**
+ * @brief streamQueued
+ * @param device the input of the stream
+ * @return true if more input can be read without waiting, buffered by the device or, for
+ * an unbuffered file such as stdin, pending on its descriptor
+ */
+static bool streamQueued(QIODevice *device)
+{
+    if(device->bytesAvailable() > 0) return true;
+#ifdef Q_OS_UNIX
+    QFileDevice *file = qobject_cast<QFileDevice*>(device);
+    if(file && file->handle() >= 0) {
+        pollfd fd{file->handle(), POLLIN, 0};
+        return poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN);
+    }
+#endif
+    return false;
+}
+
+/**
+ * @brief writeStreamFrame
+ * @param device the output of the stream
+ * @param frame the content of the frame, empty for a pair without result
+ * @return true if the frame was written
+ */
+static bool writeStreamFrame(QIODevice *device, const QByteArray &frame)
+{
+    QByteArray prefix(4, 0);
+    qToBigEndian<quint32>((quint32)frame.size(), reinterpret_cast<uchar*>(prefix.data()));
+    return device->write(prefix + frame) == frame.size() + 4;
+}
+
+/**
+ * @brief MorphStream::MorphStream
+ * @param engine the configured engine morphing the pairs
+ * @param parent the Qt parent
+ */
+MorphStream::MorphStream(MorphEngine *engine, QObject *parent) :
+    QObject(parent),
+    m_engine(engine)
+{
+    m_encoder.setWriteFiles(false);
+}
+
+/**
+ * @brief MorphStream::setEncoderThreads
+ *
+ * Sets the threads encoding the morphs while the next pairs are morphed, see run().
+ *
+ * @param threads the amount of encoder threads, 0 to encode after every morph
+ */
+void MorphStream::setEncoderThreads(int threads)
+{
+    m_encoder.setThreads(threads);
+}
+
+/**
+ * @brief MorphStream::run
+ *
+ * Morphs the pairs of the input until it ends. The images are scaled to the configured
+ * resolution, an automatic resolution is taken from the first image. While further pairs
+ * are already queued on the input, results are encoded by the encoder threads while the
+ * next pair is morphed, see setEncoderThreads(). Otherwise every pending result is written
+ * before the input is read again, such that a client may send one pair at a time and wait
+ * for its morph.
+ *
+ * @param input the open input device
+ * @param output the open output device
+ * @return true if the input ended after a complete pair, false on cancellation or failure,
+ * see MorphEngine::error()
+ */
+bool MorphStream::run(QIODevice *input, QIODevice *output)
+{
+    m_engine->resetRun();
+    m_engine->configureEncoder(m_encoder);
+    m_encoder.resetStatistics();
+
+    QByteArray frames[2];
+    bool ok = true;
+    int pairs = 0;
+    int in_flight = 2 * std::max(m_encoder.threads(), 1);
+    while(ok) {
+        qint64 size = 0;
+        qint64 received = 0;
+        if(!readStreamFrame(input, frames[0], size, received)) {
+            if(size > MAX_STREAM_FRAME) ok = m_engine->failRun(MorphEngine::INPUT_ERROR, "Oversized frame on the input stream");
+            else if(received > 0) ok = m_engine->failRun(MorphEngine::INPUT_ERROR, "The input stream ended within a frame");
+            break; // the end of the stream
+        }
+        if(!readStreamFrame(input, frames[1], size, received)) {
+            ok = m_engine->failRun(MorphEngine::INPUT_ERROR, "The input stream ended within pair " + QString::number(pairs));
+            break;
+        }
+        if(m_engine->isCanceled()) {
+            ok = m_engine->failRun(MorphEngine::CANCELED, "Canceled");
+            break;
+        }
+        // a null image keeps the order of the pairs, it is answered by an empty frame
+        m_encoder.submit(m_engine->morphFrames(frames[0], frames[1], pairs++), QString());
+        // the encoders only lag behind while the next pair is queued, a client which waits
+        // for its results before sending more pairs gets them before the input is read again
+        bool queued = streamQueued(input);
+        fmg::EncodedImage encoded;
+        while(ok && m_encoder.takeResult(encoded, !queued || m_encoder.pending() > in_flight)) {
+            ok = writeStreamFrame(output, encoded.data)
+                    || m_engine->failRun(MorphEngine::OUTPUT_ERROR, "Unable to write to the output stream");
+        }
+    }
+    fmg::EncodedImage encoded;
+    while(m_encoder.takeResult(encoded, true)) {
+        if(ok) {
+            ok = writeStreamFrame(output, encoded.data)
+                    || m_engine->failRun(MorphEngine::OUTPUT_ERROR, "Unable to write to the output stream");
+        }
+    }
+    emit message("Streamed " + QString::number(pairs) + " pairs");
+    m_engine->reportThroughput(m_encoder);
+    return ok;
+}
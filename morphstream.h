@@ -0,0 +1,35 @@
+#pragma once
+#include <QObject>
+
+#include "imageencoder.h"
+
+class MorphEngine;
+class QIODevice;
+/**
+ * @brief The MorphStream class
+ *
+ * Morphs pairs of images streamed by another process, e.g. through stdin and stdout, with
+ * the settings of a MorphEngine. The model stays loaded for the lifetime of the stream and
+ * nothing touches the filesystem. The input is a sequence of pairs, each pair being two
+ * frames of an encoded image, the output a frame of the encoded morph per pair, in the
+ * order of the pairs. A frame is a 4 byte big-endian length followed by the content, the
+ * length of a pair without result, e.g. without a detected face, is 0. Raw frames are
+ * streamed as PPM/PGM images, which the format setting 2 also produces, see
+ * MorphEngine::configure().
+ */
+class MorphStream : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphStream(MorphEngine *engine, QObject *parent = nullptr);
+
+    void setEncoderThreads(int threads);
+    bool run(QIODevice *input, QIODevice *output);
+
+signals:
+    void message(const QString &text);
+
+private:
+    MorphEngine *m_engine;
+    fmg::ImageEncoder m_encoder; // encodes to memory only
+};
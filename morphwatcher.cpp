@@ -0,0 +1,180 @@
+#include "morphwatcher.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+
+#define SETTLE_INTERVAL 1000 // ms without changes before a directory is scanned
+
+/**
+ * @brief MorphWatcher::MorphWatcher
+ *
+ * The MorphWatcher ctor, changes to the input directory are collected until it has been
+ * quiet for SETTLE_INTERVAL ms, hence a burst of copied images is processed as one batch.
+ *
+ * @param parent the Qt parent
+ */
+MorphWatcher::MorphWatcher(QObject *parent) :
+    QObject(parent)
+{
+    m_settle_timer.setSingleShot(true);
+    m_settle_timer.setInterval(SETTLE_INTERVAL);
+    connect(&m_settle_timer, SIGNAL(timeout()),
+            this, SLOT(scan()));
+
+    connect(&m_watcher, SIGNAL(directoryChanged(QString)),
+            this, SLOT(directoryChanged()));
+
+    connect(&m_engine, SIGNAL(message(QString)),
+            this, SIGNAL(message(QString)));
+}
+
+/**
+ * @brief MorphWatcher::configure
+ * @param json_path a path to the *.json settings file, see MorphEngine::configure
+ * @return true if the settings file could be read and parsed
+ */
+bool MorphWatcher::configure(const QString &json_path)
+{
+    if(m_engine.configure(json_path)) return true;
+    emit message(m_engine.errorString());
+    return false;
+}
+
+/**
+ * @brief MorphWatcher::setResume
+ * @param resume true to skip the results of a previous process, see MorphEngine::setResume
+ */
+void MorphWatcher::setResume(bool resume)
+{
+    m_engine.setResume(resume);
+}
+
+/**
+ * @brief MorphWatcher::setCacheDirectory
+ * @param directory the cache of decoded images, see MorphEngine::setCacheDirectory
+ */
+void MorphWatcher::setCacheDirectory(const QString &directory)
+{
+    m_engine.setCacheDirectory(directory);
+}
+
+/**
+ * @brief MorphWatcher::setMemoryBudget
+ * @param bytes the budget of decoded images, see MorphEngine::setMemoryBudget
+ */
+void MorphWatcher::setMemoryBudget(qint64 bytes)
+{
+    m_engine.setMemoryBudget(bytes);
+}
+
+/**
+ * @brief MorphWatcher::setEncoderThreads
+ * @param threads the threads saving the results, see MorphEngine::setEncoderThreads
+ */
+void MorphWatcher::setEncoderThreads(int threads)
+{
+    m_engine.setEncoderThreads(threads);
+}
+
+/**
+ * @brief MorphWatcher::setArchiveOutput
+ * @param shard_size the size of the result archives, see MorphEngine::setArchiveOutput
+ */
+void MorphWatcher::setArchiveOutput(qint64 shard_size)
+{
+    m_engine.setArchiveOutput(shard_size);
+}
+
+/**
+ * @brief MorphWatcher::start
+ *
+ * Morphs the images already present in the input directory and starts watching it.
+ *
+ * @param input_dir the directory to be watched
+ * @param output_dir the directory receiving the morphed results
+ * @return true if the input directory is watched
+ */
+bool MorphWatcher::start(const QString &input_dir, const QString &output_dir)
+{
+    m_input_dir = QDir(input_dir).absolutePath();
+    m_output_dir = QDir(output_dir).absolutePath();
+    if(!QFileInfo(m_input_dir).isDir() || !m_watcher.addPath(m_input_dir)) {
+        emit message("Unable to watch: " + m_input_dir);
+        return false;
+    }
+    emit message("Watching: " + m_input_dir);
+    scan();
+    return true;
+}
+
+/**
+ * @brief MorphWatcher::directoryChanged
+ *
+ * A private SLOT invoked when the input directory changed, (re)starts the settle timer.
+ *
+ */
+void MorphWatcher::directoryChanged()
+{
+    m_settle_timer.start();
+}
+
+/**
+ * @brief MorphWatcher::scan
+ *
+ * A private SLOT adding the new images of the input directory to the engine and morphing
+ * the new pairs. The images of the first scan are added together, such that the job
+ * resolution is determined by all of them, later images are added one at a time and an
+ * image which fails to load is retried on the next scan.
+ *
+ */
+void MorphWatcher::scan()
+{
+    QStringList paths = newImages();
+    if(paths.isEmpty()) return;
+
+    int added = 0;
+    if(m_known.isEmpty()) {
+        if(!m_engine.addImages(paths)) {
+            emit message(m_engine.errorString());
+            m_engine.clear(); // nothing was morphed yet, retry the whole batch later
+            return;
+        }
+        for(const QString &path : paths) m_known.insert(path);
+        added = paths.size();
+    } else {
+        for(const QString &path : paths) {
+            if(!m_engine.addImages(QStringList() << path)) {
+                emit message(m_engine.errorString());
+                continue;
+            }
+            m_known.insert(path);
+            ++added;
+        }
+    }
+    if(added == 0 || m_known.size() < 2) return;
+
+    emit message("Morphing " + QString::number(added) + " new image(s)");
+    if(!m_engine.run(m_output_dir)) emit message(m_engine.errorString());
+}
+
+/**
+ * @brief MorphWatcher::newImages
+ * @return the readable *.jpg, *.jpeg and *.png images of the input directory which have
+ * not been added yet, sorted by name
+ */
+QStringList MorphWatcher::newImages() const
+{
+    QDir files(m_input_dir);
+    files.setFilter(QDir::NoDotAndDotDot | QDir::Files);
+    files.setNameFilters(QStringList() << "*.jpg" << "*.jpeg" << "*.png");
+    files.setSorting(QDir::Name);
+    QStringList paths;
+    for(const QFileInfo &info : files.entryInfoList()) {
+        QString path = info.absoluteFilePath();
+        if(m_known.contains(path)) continue;
+        if(!QImageReader(path).canRead()) continue; // not completely written yet
+        paths << path;
+    }
+    return paths;
+}
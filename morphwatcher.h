@@ -0,0 +1,51 @@
+#pragma once
+#include <QObject>
+
+#include "morphengine.h"
+
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * @brief The MorphWatcher class
+ *
+ * The watch-folder mode of the MorphEngine. The input directory is monitored through a
+ * QFileSystemWatcher, images dropped into it are loaded, their landmarks are detected and
+ * only the new pairs are morphed, i.e. new x existing and new x new. Images which can not
+ * be loaded yet, e.g. because they are still being copied, are retried on the next change.
+ */
+class MorphWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphWatcher(QObject *parent = nullptr);
+
+    bool configure(const QString &json_path);
+    void setResume(bool resume);
+    void setCacheDirectory(const QString &directory);
+    void setMemoryBudget(qint64 bytes);
+    void setEncoderThreads(int threads);
+    void setArchiveOutput(qint64 shard_size);
+    bool start(const QString &input_dir, const QString &output_dir);
+
+signals:
+    void message(const QString &text);
+
+private slots:
+    void directoryChanged();
+    void scan();
+
+private:
+    QStringList newImages() const;
+
+private:
+    MorphEngine m_engine;
+    QFileSystemWatcher m_watcher;
+    QTimer m_settle_timer;
+    QString m_input_dir;
+    QString m_output_dir;
+    QSet<QString> m_known;
+};
@@ -0,0 +1,270 @@
+#include "morphworker.h"
+
+#include "morphservice.h"
+
+#include <QJsonArray>
+
+#define HEARTBEAT_INTERVAL 5000 // ms between heartbeats, see MorphCoordinator
+#define WAIT_INTERVAL 1000 // ms before a batch is requested again after a "wait"
+
+/**
+ * @brief MorphWorker::MorphWorker
+ *
+ * The MorphWorker ctor, constructs the MorphBatchRunner and starts its thread.
+ *
+ * @param parent the Qt parent
+ */
+MorphWorker::MorphWorker(QObject *parent) :
+    QObject(parent),
+    m_runner(new MorphBatchRunner),
+    m_done(false)
+{
+    m_runner->moveToThread(&m_thread);
+    connect(&m_thread, SIGNAL(finished()),
+            m_runner, SLOT(deleteLater()));
+
+    connect(m_runner, SIGNAL(message(QString)),
+            this, SIGNAL(message(QString)));
+
+    connect(m_runner, SIGNAL(landmarksReady(int, QVector<QPoint>)),
+            this, SLOT(engineLandmarks(int, QVector<QPoint>)));
+
+    connect(m_runner, SIGNAL(resultReady(MorphResult)),
+            this, SLOT(engineResult(MorphResult)));
+
+    connect(m_runner, SIGNAL(batchFinished(int, bool, QString)),
+            this, SLOT(engineBatchFinished(int, bool, QString)));
+
+    connect(m_runner, SIGNAL(finished(bool, QString)),
+            this, SLOT(engineFinished(bool, QString)));
+
+    connect(&m_socket, SIGNAL(connected()),
+            this, SLOT(connected()));
+
+    connect(&m_socket, SIGNAL(readyRead()),
+            this, SLOT(readResponses()));
+
+    connect(&m_socket, SIGNAL(disconnected()),
+            this, SLOT(disconnected()));
+
+    connect(&m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
+            this, SLOT(disconnected()));
+
+    m_heartbeat_timer.setInterval(HEARTBEAT_INTERVAL);
+    connect(&m_heartbeat_timer, SIGNAL(timeout()),
+            this, SLOT(sendHeartbeat()));
+
+    m_thread.start();
+}
+
+/**
+ * @brief MorphWorker::~MorphWorker
+ *
+ * Cancels the running batch and stops the engine thread.
+ *
+ */
+MorphWorker::~MorphWorker()
+{
+    m_runner->cancel();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief MorphWorker::connectToCoordinator
+ * @param host the host name or address of the coordinator
+ * @param port the TCP port of the coordinator
+ */
+void MorphWorker::connectToCoordinator(const QString &host, quint16 port)
+{
+    emit message("Connecting to the coordinator: " + host + ":" + QString::number(port));
+    m_socket.connectToHost(host, port);
+}
+
+/**
+ * @brief MorphWorker::setCacheDirectory
+ *
+ * Sets the cache of decoded images local to this worker, see MorphEngine::setCacheDirectory,
+ * it is added to the job received from the coordinator.
+ *
+ * @param directory the cache directory, empty to disable the cache
+ */
+void MorphWorker::setCacheDirectory(const QString &directory)
+{
+    m_cache_directory = directory;
+}
+
+/**
+ * @brief MorphWorker::connected
+ *
+ * A private SLOT invoked when the connection is established, the job is requested.
+ *
+ */
+void MorphWorker::connected()
+{
+    m_heartbeat_timer.start();
+    send(QJsonObject{{"type", "hello"}});
+}
+
+/**
+ * @brief MorphWorker::readResponses
+ *
+ * A private SLOT invoked when the coordinator sent data. The job is prepared and the
+ * batches are run by the runner, in the order they were received.
+ *
+ */
+void MorphWorker::readResponses()
+{
+    m_buffer += m_socket.readAll();
+    QJsonObject response;
+    bool malformed = false;
+    while(MorphService::nextFrame(m_buffer, response, &malformed)) {
+        QString type = response["type"].toString();
+        if(type == "job") {
+            if(!m_cache_directory.isEmpty()) response["cache"] = m_cache_directory;
+            QMetaObject::invokeMethod(m_runner, "prepareJob", Qt::QueuedConnection,
+                                      Q_ARG(QJsonObject, response));
+            requestBatch();
+        } else if(type == "batch") {
+            QMetaObject::invokeMethod(m_runner, "runBatch", Qt::QueuedConnection,
+                                      Q_ARG(QJsonObject, response));
+        } else if(type == "wait") {
+            QTimer::singleShot(WAIT_INTERVAL, this, SLOT(requestBatch()));
+        } else if(type == "done") {
+            emit message("The job is done");
+            finish(true);
+            m_socket.disconnectFromHost();
+            return;
+        }
+    }
+    if(malformed) {
+        emit message("Malformed response, disconnecting");
+        m_socket.abort();
+    }
+}
+
+/**
+ * @brief MorphWorker::disconnected
+ *
+ * A private SLOT invoked when the connection is lost or could not be established, the
+ * running batch is canceled.
+ *
+ */
+void MorphWorker::disconnected()
+{
+    m_heartbeat_timer.stop();
+    if(m_done) return;
+    m_runner->cancel();
+    emit message("Lost the connection to the coordinator: " + m_socket.errorString());
+    finish(false);
+}
+
+/**
+ * @brief MorphWorker::requestBatch
+ *
+ * A private SLOT requesting the next batch.
+ *
+ */
+void MorphWorker::requestBatch()
+{
+    send(QJsonObject{{"type", "request"}});
+}
+
+/**
+ * @brief MorphWorker::sendHeartbeat
+ *
+ * A private SLOT invoked every HEARTBEAT_INTERVAL ms.
+ *
+ */
+void MorphWorker::sendHeartbeat()
+{
+    send(QJsonObject{{"type", "heartbeat"}});
+}
+
+/**
+ * @brief MorphWorker::engineLandmarks
+ *
+ * A private SLOT publishing the landmarks detected by the engine, empty if no face was
+ * detected.
+ *
+ * @param image the index of the image among the images of the job
+ * @param landmarks the detected landmarks
+ */
+void MorphWorker::engineLandmarks(int image, const QVector<QPoint> &landmarks)
+{
+    QJsonArray points;
+    for(const QPoint &point : landmarks) {
+        points.append(point.x());
+        points.append(point.y());
+    }
+    send(QJsonObject{{"type", "landmarks"}, {"image", image}, {"points", points}});
+}
+
+/**
+ * @brief MorphWorker::engineResult
+ * @param result a result of the running batch
+ */
+void MorphWorker::engineResult(const MorphResult &result)
+{
+    send(QJsonObject{{"type", "result"},
+                     {"one", result.reference_one},
+                     {"two", result.reference_two},
+                     {"path", result.path},
+                     {"error", result.error},
+                     {"sha1", result.digest}});
+}
+
+/**
+ * @brief MorphWorker::engineBatchFinished
+ *
+ * A private SLOT reporting a finished batch and requesting the next one.
+ *
+ * @param batch the id of the batch
+ * @param ok true if the batch succeeded
+ * @param error the description of the failure
+ */
+void MorphWorker::engineBatchFinished(int batch, bool ok, const QString &error)
+{
+    send(QJsonObject{{"type", "complete"}, {"id", batch}, {"ok", ok}, {"error", error}});
+    requestBatch();
+}
+
+/**
+ * @brief MorphWorker::engineFinished
+ *
+ * A private SLOT invoked if the job could not be prepared.
+ *
+ * @param ok true if the job succeeded
+ * @param error the description of the failure
+ */
+void MorphWorker::engineFinished(bool ok, const QString &error)
+{
+    if(ok) return;
+    emit message(error);
+    finish(false);
+    m_socket.disconnectFromHost();
+}
+
+/**
+ * @brief MorphWorker::finish
+ *
+ * A private convenience method emitting finished() once.
+ *
+ * @param ok true if the job is done
+ */
+void MorphWorker::finish(bool ok)
+{
+    if(m_done) return;
+    m_done = true;
+    emit finished(ok);
+}
+
+/**
+ * @brief MorphWorker::send
+ * @param object the json object to be sent
+ */
+void MorphWorker::send(const QJsonObject &object)
+{
+    if(m_socket.state() != QAbstractSocket::ConnectedState) return;
+    m_socket.write(MorphService::frame(object));
+}
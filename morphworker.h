@@ -0,0 +1,59 @@
+#pragma once
+#include <QObject>
+
+#include "morphbatchrunner.h"
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+/**
+ * @brief The MorphWorker class
+ *
+ * A worker process of a distributed job, see MorphCoordinator. The worker pulls one batch
+ * at a time and runs it on a MorphBatchRunner in a separate thread, such that heartbeats keep
+ * being sent while a batch runs. Detected landmarks and results are reported back as they
+ * are produced. finished() is emitted when the coordinator reports the job as done or the
+ * connection is lost.
+ */
+class MorphWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MorphWorker(QObject *parent = nullptr);
+    ~MorphWorker();
+
+    void connectToCoordinator(const QString &host, quint16 port);
+    void setCacheDirectory(const QString &directory);
+
+signals:
+    void message(const QString &text);
+    void finished(bool ok);
+
+private slots:
+    void connected();
+    void readResponses();
+    void disconnected();
+    void requestBatch();
+    void sendHeartbeat();
+    void engineLandmarks(int image, const QVector<QPoint> &landmarks);
+    void engineResult(const MorphResult &result);
+    void engineBatchFinished(int batch, bool ok, const QString &error);
+    void engineFinished(bool ok, const QString &error);
+
+private:
+    void finish(bool ok);
+    void send(const QJsonObject &object);
+
+private:
+    QTcpSocket m_socket;
+    QByteArray m_buffer;
+    QTimer m_heartbeat_timer;
+    QThread m_thread;
+    MorphBatchRunner *m_runner;
+    bool m_done;
+    QString m_cache_directory;
+};
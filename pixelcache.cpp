@@ -0,0 +1,109 @@
+#include "pixelcache.h"
+
+#include "imagebridge.h"
+
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#define CACHE_MAGIC "FMGPIX01"
+#define CACHE_HEADER_SIZE 64 // keeps the scanlines aligned within the mapping
+
+namespace fmg {
+/**
+ * @brief The CacheHeader struct
+ * The header of a cache entry, in host byte order, the cache is local to a machine.
+ */
+struct CacheHeader
+{
+    char magic[8];
+    qint32 width;
+    qint32 height;
+    qint32 bytes_per_line;
+    qint32 format;
+};
+
+/**
+ * @brief unmapEntry
+ *
+ * The QImageCleanupFunction of PixelCache::load(), deleting the QFile unmaps the entry.
+ *
+ * @param info the heap allocated QFile of the mapped entry
+ */
+static void unmapEntry(void *info)
+{
+    delete static_cast<QFile*>(info);
+}
+
+/**
+ * @brief PixelCache::entryPath
+ * @param directory the cache directory
+ * @param digest the hex encoded content digest of the source file
+ * @param size the target resolution
+ * @return the path of the cache entry
+ */
+QString PixelCache::entryPath(const QString &directory, const QByteArray &digest, const QSize &size)
+{
+    return directory + "/" + QString::fromLatin1(digest) + "_" + QString::number(size.width())
+            + "x" + QString::number(size.height()) + ".pix";
+}
+
+/**
+ * @brief PixelCache::load
+ * @param directory the cache directory
+ * @param digest the hex encoded content digest of the source file
+ * @param size the target resolution
+ * @return the memory mapped image, null if the entry does not exist or is invalid
+ */
+QImage PixelCache::load(const QString &directory, const QByteArray &digest, const QSize &size)
+{
+    QFile *file = new QFile(entryPath(directory, digest, size));
+    CacheHeader header;
+    if(!file->open(QIODevice::ReadOnly)
+            || file->read(reinterpret_cast<char*>(&header), sizeof(header)) != (qint64)sizeof(header)
+            || std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+            || header.width != size.width() || header.height != size.height()
+            || header.format != (qint32)ImageBridge::CANONICAL_FORMAT
+            || file->size() != CACHE_HEADER_SIZE + (qint64)header.bytes_per_line * header.height) {
+        delete file;
+        return QImage();
+    }
+    uchar *pixels = file->map(CACHE_HEADER_SIZE, (qint64)header.bytes_per_line * header.height);
+    if(!pixels) {
+        delete file;
+        return QImage();
+    }
+    const uchar *data = pixels;
+    return QImage(data, header.width, header.height, header.bytes_per_line,
+                  ImageBridge::CANONICAL_FORMAT, unmapEntry, file);
+}
+
+/**
+ * @brief PixelCache::store
+ * @param directory the cache directory, created if it does not exist
+ * @param digest the hex encoded content digest of the source file
+ * @param image the decoded, rescaled and canonical image
+ * @return true if the entry was written
+ */
+bool PixelCache::store(const QString &directory, const QByteArray &digest, const QImage &image)
+{
+    if(image.isNull() || image.format() != ImageBridge::CANONICAL_FORMAT) return false;
+    if(!QDir().mkpath(directory)) return false;
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.width = image.width();
+    header.height = image.height();
+    header.bytes_per_line = image.bytesPerLine();
+    header.format = (qint32)image.format();
+    QByteArray padded(CACHE_HEADER_SIZE, 0);
+    std::memcpy(padded.data(), &header, sizeof(header));
+
+    QSaveFile file(entryPath(directory, digest, image.size()));
+    if(!file.open(QIODevice::WriteOnly)) return false;
+    file.write(padded);
+    file.write(reinterpret_cast<const char*>(image.constBits()), (qint64)image.bytesPerLine() * image.height());
+    return file.commit();
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace fmg {
+/**
+ * @brief The PixelCache struct
+ *
+ * An opt-in disk cache of decoded, rescaled and canonical (see ImageBridge) source images,
+ * keyed by the content digest of the source file and the target resolution. An entry is a
+ * 64 byte header followed by the raw scanlines, such that a cached image is memory mapped
+ * and wrapped by a QImage without decoding or copying pixels. Entries are written
+ * atomically, an entry with an unexpected header or size is ignored and rewritten.
+ *
+ * Ownership: load() returns a read-only QImage over the mapping, the mapping is released
+ * with the last copy of the QImage. Modifying the image detaches it from the mapping.
+ */
+struct PixelCache {
+    static QString entryPath(const QString &directory, const QByteArray &digest, const QSize &size);
+    static QImage load(const QString &directory, const QByteArray &digest, const QSize &size);
+    static bool store(const QString &directory, const QByteArray &digest, const QImage &image);
+};
+}
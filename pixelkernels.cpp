@@ -0,0 +1,473 @@
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FMG_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace fmg {
+
+/*
+ * Scalar reference implementations, these define the results of every other variant.
+ */
+
+static void blendScalar(const float *one, const float *two, const float *mask,
+                        float *target, std::size_t n, float alpha)
+{
+    for(std::size_t i = 0; i < n; ++i) {
+        const float value = (1.0f - alpha) * one[i] + alpha * two[i];
+        target[i] = target[i] * (1.0f - mask[i]) + value * mask[i];
+    }
+}
+
+static void scaleShiftScalar(const std::uint8_t *source, std::uint8_t *target,
+                             std::size_t n, float scale, float shift)
+{
+    for(std::size_t i = 0; i < n; ++i) {
+        const long value = std::lrint(source[i] * scale + shift);
+        target[i] = (std::uint8_t)std::min(255L, std::max(0L, value));
+    }
+}
+
+static void rgbToGrayScalar(const std::uint8_t *rgb, std::uint8_t *gray, std::size_t pixels)
+{
+    for(std::size_t i = 0; i < pixels; ++i) {
+        const std::uint8_t *p = rgb + 3 * i;
+        gray[i] = (std::uint8_t)((p[0] * 11 + p[1] * 16 + p[2] * 5) >> 5);
+    }
+}
+
+static void swapRedBlueScalar(const std::uint8_t *source, std::uint8_t *target, std::size_t pixels)
+{
+    for(std::size_t i = 0; i < pixels; ++i) {
+        const std::uint8_t *s = source + 3 * i;
+        std::uint8_t *t = target + 3 * i;
+        const std::uint8_t r = s[0];
+        t[1] = s[1];
+        t[0] = s[2];
+        t[2] = r;
+    }
+}
+
+#ifdef FMG_X86_KERNELS
+
+/*
+ * pshufb masks deinterleaving 16 RGB888 pixels held in three registers into one register per
+ * channel, DEINTERLEAVE[channel][register], and swapping the first and third channel of those
+ * pixels, SWAP[output register][input register]. -128 zeroes the destination byte.
+ */
+alignas(16) static const std::int8_t DEINTERLEAVE[3][3][16] = {
+    {{0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 4, 7, 10, 13}},
+    {{1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14}},
+    {{2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15}}
+};
+
+alignas(16) static const std::int8_t SWAP[3][3][16] = {
+    {{2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128}},
+    {{-128, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {0, -128, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -128, 15},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, -128}},
+    {{-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13}}
+};
+
+#define FMG_MASK(table, a, b) _mm_load_si128(reinterpret_cast<const __m128i*>(table[a][b]))
+
+/*
+ * SSE4.2 variants.
+ */
+
+__attribute__((target("sse4.2")))
+static inline __m128i deinterleave(__m128i a, __m128i b, __m128i c, int channel)
+{
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, FMG_MASK(DEINTERLEAVE, channel, 0)),
+                                     _mm_shuffle_epi8(b, FMG_MASK(DEINTERLEAVE, channel, 1))),
+                        _mm_shuffle_epi8(c, FMG_MASK(DEINTERLEAVE, channel, 2)));
+}
+
+__attribute__((target("sse4.2")))
+static void blendSse42(const float *one, const float *two, const float *mask,
+                       float *target, std::size_t n, float alpha)
+{
+    const __m128 a = _mm_set1_ps(alpha);
+    const __m128 inv_a = _mm_set1_ps(1.0f - alpha);
+    const __m128 ones = _mm_set1_ps(1.0f);
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        const __m128 m = _mm_loadu_ps(mask + i);
+        const __m128 value = _mm_add_ps(_mm_mul_ps(inv_a, _mm_loadu_ps(one + i)),
+                                        _mm_mul_ps(a, _mm_loadu_ps(two + i)));
+        const __m128 kept = _mm_mul_ps(_mm_loadu_ps(target + i), _mm_sub_ps(ones, m));
+        _mm_storeu_ps(target + i, _mm_add_ps(kept, _mm_mul_ps(value, m)));
+    }
+    blendScalar(one + i, two + i, mask + i, target + i, n - i, alpha);
+}
+
+__attribute__((target("sse4.2")))
+static void scaleShiftSse42(const std::uint8_t *source, std::uint8_t *target,
+                            std::size_t n, float scale, float shift)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 t = _mm_set1_ps(shift);
+    std::size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i q[4];
+        for(int k = 0; k < 4; ++k) {
+            const __m128i widened = _mm_cvtepu8_epi32(k == 0 ? bytes : k == 1 ? _mm_srli_si128(bytes, 4)
+                                                    : k == 2 ? _mm_srli_si128(bytes, 8) : _mm_srli_si128(bytes, 12));
+            q[k] = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(widened), s), t));
+        }
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), packed);
+    }
+    scaleShiftScalar(source + i, target + i, n - i, scale, shift);
+}
+
+__attribute__((target("sse4.2")))
+static void rgbToGraySse42(const std::uint8_t *rgb, std::uint8_t *gray, std::size_t pixels)
+{
+    const __m128i wr = _mm_set1_epi16(11);
+    const __m128i wg = _mm_set1_epi16(16);
+    const __m128i wb = _mm_set1_epi16(5);
+    std::size_t i = 0;
+    for(; i + 16 <= pixels; i += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i*>(rgb + 3 * i);
+        const __m128i a = _mm_loadu_si128(p);
+        const __m128i b = _mm_loadu_si128(p + 1);
+        const __m128i c = _mm_loadu_si128(p + 2);
+        const __m128i r = deinterleave(a, b, c, 0);
+        const __m128i g = deinterleave(a, b, c, 1);
+        const __m128i bl = deinterleave(a, b, c, 2);
+        __m128i half[2];
+        for(int k = 0; k < 2; ++k) {
+            const __m128i r16 = _mm_cvtepu8_epi16(k == 0 ? r : _mm_srli_si128(r, 8));
+            const __m128i g16 = _mm_cvtepu8_epi16(k == 0 ? g : _mm_srli_si128(g, 8));
+            const __m128i b16 = _mm_cvtepu8_epi16(k == 0 ? bl : _mm_srli_si128(bl, 8));
+            const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r16, wr), _mm_mullo_epi16(g16, wg)),
+                                              _mm_mullo_epi16(b16, wb));
+            half[k] = _mm_srli_epi16(sum, 5);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i), _mm_packus_epi16(half[0], half[1]));
+    }
+    rgbToGrayScalar(rgb + 3 * i, gray + i, pixels - i);
+}
+
+__attribute__((target("sse4.2")))
+static void swapRedBlueSse42(const std::uint8_t *source, std::uint8_t *target, std::size_t pixels)
+{
+    std::size_t i = 0;
+    for(; i + 16 <= pixels; i += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i*>(source + 3 * i);
+        __m128i *q = reinterpret_cast<__m128i*>(target + 3 * i);
+        const __m128i a = _mm_loadu_si128(p);
+        const __m128i b = _mm_loadu_si128(p + 1);
+        const __m128i c = _mm_loadu_si128(p + 2);
+        const __m128i x = _mm_or_si128(_mm_shuffle_epi8(a, FMG_MASK(SWAP, 0, 0)),
+                                       _mm_shuffle_epi8(b, FMG_MASK(SWAP, 0, 1)));
+        const __m128i y = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, FMG_MASK(SWAP, 1, 0)),
+                                                    _mm_shuffle_epi8(b, FMG_MASK(SWAP, 1, 1))),
+                                       _mm_shuffle_epi8(c, FMG_MASK(SWAP, 1, 2)));
+        const __m128i z = _mm_or_si128(_mm_shuffle_epi8(b, FMG_MASK(SWAP, 2, 1)),
+                                       _mm_shuffle_epi8(c, FMG_MASK(SWAP, 2, 2)));
+        _mm_storeu_si128(q, x);
+        _mm_storeu_si128(q + 1, y);
+        _mm_storeu_si128(q + 2, z);
+    }
+    swapRedBlueScalar(source + 3 * i, target + 3 * i, pixels - i);
+}
+
+/*
+ * AVX2 variants. The 3-byte pixel layout does not map onto the 128-bit lanes of the wider
+ * registers, hence the channel shuffles of rgbToGray remain 128-bit and swapRedBlue shares
+ * the SSE4.2 variant.
+ */
+
+__attribute__((target("avx2")))
+static void blendAvx2(const float *one, const float *two, const float *mask,
+                      float *target, std::size_t n, float alpha)
+{
+    const __m256 a = _mm256_set1_ps(alpha);
+    const __m256 inv_a = _mm256_set1_ps(1.0f - alpha);
+    const __m256 ones = _mm256_set1_ps(1.0f);
+    std::size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        const __m256 m = _mm256_loadu_ps(mask + i);
+        const __m256 value = _mm256_add_ps(_mm256_mul_ps(inv_a, _mm256_loadu_ps(one + i)),
+                                           _mm256_mul_ps(a, _mm256_loadu_ps(two + i)));
+        const __m256 kept = _mm256_mul_ps(_mm256_loadu_ps(target + i), _mm256_sub_ps(ones, m));
+        _mm256_storeu_ps(target + i, _mm256_add_ps(kept, _mm256_mul_ps(value, m)));
+    }
+    blendScalar(one + i, two + i, mask + i, target + i, n - i, alpha);
+}
+
+__attribute__((target("avx2")))
+static void scaleShiftAvx2(const std::uint8_t *source, std::uint8_t *target,
+                           std::size_t n, float scale, float shift)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256 t = _mm256_set1_ps(shift);
+    std::size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m256i lo = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), s), t));
+        const __m256i hi = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8))), s), t));
+        const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        const __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), packed);
+    }
+    scaleShiftScalar(source + i, target + i, n - i, scale, shift);
+}
+
+__attribute__((target("avx2")))
+static void rgbToGrayAvx2(const std::uint8_t *rgb, std::uint8_t *gray, std::size_t pixels)
+{
+    const __m256i wr = _mm256_set1_epi16(11);
+    const __m256i wg = _mm256_set1_epi16(16);
+    const __m256i wb = _mm256_set1_epi16(5);
+    std::size_t i = 0;
+    for(; i + 16 <= pixels; i += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i*>(rgb + 3 * i);
+        const __m128i a = _mm_loadu_si128(p);
+        const __m128i b = _mm_loadu_si128(p + 1);
+        const __m128i c = _mm_loadu_si128(p + 2);
+        const __m256i r = _mm256_cvtepu8_epi16(deinterleave(a, b, c, 0));
+        const __m256i g = _mm256_cvtepu8_epi16(deinterleave(a, b, c, 1));
+        const __m256i bl = _mm256_cvtepu8_epi16(deinterleave(a, b, c, 2));
+        const __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, wr), _mm256_mullo_epi16(g, wg)),
+                                             _mm256_mullo_epi16(bl, wb));
+        const __m256i words = _mm256_srli_epi16(sum, 5);
+        const __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + i), packed);
+    }
+    rgbToGrayScalar(rgb + 3 * i, gray + i, pixels - i);
+}
+
+/*
+ * AVX-512 variants, requiring AVX-512F and AVX-512BW.
+ */
+
+__attribute__((target("avx512f,avx512bw")))
+static void blendAvx512(const float *one, const float *two, const float *mask,
+                        float *target, std::size_t n, float alpha)
+{
+    const __m512 a = _mm512_set1_ps(alpha);
+    const __m512 inv_a = _mm512_set1_ps(1.0f - alpha);
+    const __m512 ones = _mm512_set1_ps(1.0f);
+    std::size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        const __m512 m = _mm512_loadu_ps(mask + i);
+        const __m512 value = _mm512_add_ps(_mm512_mul_ps(inv_a, _mm512_loadu_ps(one + i)),
+                                           _mm512_mul_ps(a, _mm512_loadu_ps(two + i)));
+        const __m512 kept = _mm512_mul_ps(_mm512_loadu_ps(target + i), _mm512_sub_ps(ones, m));
+        _mm512_storeu_ps(target + i, _mm512_add_ps(kept, _mm512_mul_ps(value, m)));
+    }
+    blendScalar(one + i, two + i, mask + i, target + i, n - i, alpha);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void scaleShiftAvx512(const std::uint8_t *source, std::uint8_t *target,
+                             std::size_t n, float scale, float shift)
+{
+    const __m512 s = _mm512_set1_ps(scale);
+    const __m512 t = _mm512_set1_ps(shift);
+    const __m512i zero = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m512 value = _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes)), s), t);
+        const __m512i rounded = _mm512_max_epi32(_mm512_cvtps_epi32(value), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm512_cvtusepi32_epi8(rounded));
+    }
+    scaleShiftScalar(source + i, target + i, n - i, scale, shift);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void rgbToGrayAvx512(const std::uint8_t *rgb, std::uint8_t *gray, std::size_t pixels)
+{
+    const __m512i wr = _mm512_set1_epi16(11);
+    const __m512i wg = _mm512_set1_epi16(16);
+    const __m512i wb = _mm512_set1_epi16(5);
+    std::size_t i = 0;
+    for(; i + 32 <= pixels; i += 32) {
+        const __m128i *p = reinterpret_cast<const __m128i*>(rgb + 3 * i);
+        __m128i channels[3][2];
+        for(int k = 0; k < 2; ++k) {
+            const __m128i a = _mm_loadu_si128(p + 3 * k);
+            const __m128i b = _mm_loadu_si128(p + 3 * k + 1);
+            const __m128i c = _mm_loadu_si128(p + 3 * k + 2);
+            for(int channel = 0; channel < 3; ++channel) {
+                channels[channel][k] = deinterleave(a, b, c, channel);
+            }
+        }
+        __m512i widened[3];
+        for(int channel = 0; channel < 3; ++channel) {
+            const __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(channels[channel][0]),
+                                                          channels[channel][1], 1);
+            widened[channel] = _mm512_cvtepu8_epi16(bytes);
+        }
+        const __m512i sum = _mm512_add_epi16(_mm512_add_epi16(_mm512_mullo_epi16(widened[0], wr),
+                                                              _mm512_mullo_epi16(widened[1], wg)),
+                                             _mm512_mullo_epi16(widened[2], wb));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(gray + i), _mm512_cvtepi16_epi8(_mm512_srli_epi16(sum, 5)));
+    }
+    rgbToGrayScalar(rgb + 3 * i, gray + i, pixels - i);
+}
+
+#undef FMG_MASK
+
+/**
+ * @brief xgetbv
+ * @return the XCR0 register, the register states enabled by the operating system
+ */
+static std::uint64_t xgetbv()
+{
+    std::uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((std::uint64_t)edx << 32) | eax;
+}
+
+#endif
+
+/**
+ * @brief PixelKernels::detectIsa
+ *
+ * Determines the widest instruction set supported by both the processor, through CPUID,
+ * and the operating system, through XGETBV, as AVX and AVX-512 registers are only usable
+ * when the operating system saves their state.
+ *
+ * @return the widest supported Isa
+ */
+PixelKernels::Isa PixelKernels::detectIsa()
+{
+#ifdef FMG_X86_KERNELS
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return SCALAR;
+    const bool sse42 = (ecx & bit_SSE4_2) && (ecx & bit_SSSE3);
+    if(!sse42) return SCALAR;
+    const bool osxsave = ecx & bit_OSXSAVE;
+    if(!osxsave || __get_cpuid_max(0, nullptr) < 7) return SSE42;
+    const std::uint64_t xcr0 = xgetbv();
+    if((xcr0 & 0x6) != 0x6) return SSE42;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    const bool avx2 = ebx & (1u << 5);
+    const bool avx512 = (ebx & (1u << 16)) && (ebx & (1u << 30)) && (xcr0 & 0xE6) == 0xE6;
+    if(avx2 && avx512) return AVX512;
+    if(avx2) return AVX2;
+    return SSE42;
+#else
+    return SCALAR;
+#endif
+}
+
+/**
+ * @brief PixelKernels::forIsa
+ *
+ * Constructs the kernel table of a specific Isa, the caller is responsible for the Isa being
+ * supported, see detectIsa(). Used by get() and selfTest().
+ *
+ * @param isa the instruction set
+ * @return the kernel table
+ */
+PixelKernels PixelKernels::forIsa(Isa isa)
+{
+    PixelKernels kernels = {blendScalar, scaleShiftScalar, rgbToGrayScalar, swapRedBlueScalar, SCALAR};
+#ifdef FMG_X86_KERNELS
+    switch(isa) {
+    case AVX512:
+        kernels = {blendAvx512, scaleShiftAvx512, rgbToGrayAvx512, swapRedBlueSse42, AVX512};
+        break;
+    case AVX2:
+        kernels = {blendAvx2, scaleShiftAvx2, rgbToGrayAvx2, swapRedBlueSse42, AVX2};
+        break;
+    case SSE42:
+        kernels = {blendSse42, scaleShiftSse42, rgbToGraySse42, swapRedBlueSse42, SSE42};
+        break;
+    case SCALAR:
+        break;
+    }
+#else
+    (void)isa;
+#endif
+    return kernels;
+}
+
+/**
+ * @brief PixelKernels::get
+ *
+ * The kernel table of the executing processor, the dispatch is resolved once.
+ *
+ * @return the kernel table
+ */
+const PixelKernels &PixelKernels::get()
+{
+    static const PixelKernels kernels = forIsa(detectIsa());
+    return kernels;
+}
+
+/**
+ * @brief PixelKernels::selfTest
+ *
+ * Verifies one variant against the scalar reference implementations, on pseudo-random
+ * buffers whose lengths exercise the vector loops as well as the scalar tails. The scaled
+ * bytes may differ by one where the processor fuses the multiply-add, and the blended
+ * floats by rounding.
+ *
+ * @param isa the instruction set, supported by the executing processor, see detectIsa()
+ * @return true if the variant agrees with the reference
+ */
+bool PixelKernels::selfTest(Isa isa)
+{
+    const PixelKernels reference = forIsa(SCALAR);
+    const PixelKernels kernels = forIsa(isa);
+    std::srand(42);
+    for(std::size_t n : {std::size_t(1), std::size_t(15), std::size_t(16), std::size_t(33),
+                         std::size_t(127), std::size_t(1021)}) {
+        std::vector<std::uint8_t> bytes(3 * n), expected(3 * n), actual(3 * n);
+        std::vector<float> one(n), two(n), mask(n), blend_expected(n), blend_actual(n);
+        for(std::size_t i = 0; i < 3 * n; ++i) bytes[i] = (std::uint8_t)(std::rand() & 0xFF);
+        for(std::size_t i = 0; i < n; ++i) {
+            one[i] = (float)(std::rand() % 256);
+            two[i] = (float)(std::rand() % 256);
+            mask[i] = (float)(std::rand() % 257) / 256.0f;
+            blend_expected[i] = blend_actual[i] = (float)(std::rand() % 256);
+        }
+
+        reference.blend(one.data(), two.data(), mask.data(), blend_expected.data(), n, 0.3f);
+        kernels.blend(one.data(), two.data(), mask.data(), blend_actual.data(), n, 0.3f);
+        for(std::size_t i = 0; i < n; ++i) {
+            if(std::fabs(blend_expected[i] - blend_actual[i]) > 1e-3f) return false;
+        }
+
+        reference.scaleShift(bytes.data(), expected.data(), 3 * n, 1.37f, -20.0f);
+        kernels.scaleShift(bytes.data(), actual.data(), 3 * n, 1.37f, -20.0f);
+        for(std::size_t i = 0; i < 3 * n; ++i) {
+            if(std::abs(expected[i] - actual[i]) > 1) return false;
+        }
+
+        reference.rgbToGray(bytes.data(), expected.data(), n);
+        kernels.rgbToGray(bytes.data(), actual.data(), n);
+        if(!std::equal(expected.begin(), expected.begin() + n, actual.begin())) return false;
+
+        reference.swapRedBlue(bytes.data(), expected.data(), n);
+        kernels.swapRedBlue(bytes.data(), actual.data(), n);
+        if(expected != actual) return false;
+    }
+    return true;
+}
+}
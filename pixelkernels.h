@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fmg {
+/**
+ * @brief The PixelKernels struct
+ *
+ * A table of the hot per-pixel routines of the application. Every routine has a scalar
+ * reference implementation and SSE4.2, AVX2 and AVX-512 variants, the widest variant
+ * supported by the executing processor is selected through CPUID on first use of get().
+ */
+struct PixelKernels {
+    enum Isa {
+        SCALAR, SSE42, AVX2, AVX512
+    };
+
+    /**
+     * target = target * (1 - mask) + mask * ((1 - alpha) * one + alpha * two), over n floats.
+     */
+    void (*blend)(const float *one, const float *two, const float *mask,
+                  float *target, std::size_t n, float alpha);
+
+    /**
+     * target = saturate(round(source * scale + shift)), over n bytes, i.e. cv::Mat::convertTo.
+     */
+    void (*scaleShift)(const std::uint8_t *source, std::uint8_t *target,
+                       std::size_t n, float scale, float shift);
+
+    /**
+     * gray = (11 * r + 16 * g + 5 * b) / 32, over n RGB888 pixels, i.e. qGray().
+     */
+    void (*rgbToGray)(const std::uint8_t *rgb, std::uint8_t *gray, std::size_t pixels);
+
+    /**
+     * Swaps the first and third channel of n 3-byte pixels, RGB888 <-> BGR888.
+     */
+    void (*swapRedBlue)(const std::uint8_t *source, std::uint8_t *target, std::size_t pixels);
+
+    Isa isa;
+
+    static const PixelKernels &get();
+    static PixelKernels forIsa(Isa isa);
+    static Isa detectIsa();
+    static bool selfTest(Isa isa);
+};
+}
@@ -0,0 +1,343 @@
+#include "resultarchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#define TAR_BLOCK 512
+#define TAR_NAME_SIZE 100
+#define SHARD_DIGITS 4
+
+namespace fmg {
+/**
+ * @brief padded
+ * @param size a file size
+ * @return the size rounded up to whole tar blocks
+ */
+static qint64 padded(qint64 size)
+{
+    return (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+}
+
+/**
+ * @brief octal
+ * @param value a non-negative number
+ * @param digits the width of the field, without the terminating NUL
+ * @return the zero padded octal digits of a tar header field
+ */
+static QByteArray octal(qint64 value, int digits)
+{
+    return QByteArray::number(value, 8).rightJustified(digits, '0');
+}
+
+/**
+ * @brief ResultArchive::ResultArchive
+ */
+ResultArchive::ResultArchive() :
+    m_shard_size(0),
+    m_shard(0)
+{
+}
+
+/**
+ * @brief ResultArchive::~ResultArchive
+ *
+ * Terminates the current shard.
+ *
+ */
+ResultArchive::~ResultArchive()
+{
+    close();
+}
+
+/**
+ * @brief ResultArchive::open
+ *
+ * Opens the archive for appending, continuing the last existing shard of the prefix, if
+ * any. Content of the last shard which is not recorded in its index is discarded.
+ *
+ * @param directory the directory of the shards
+ * @param prefix the file name prefix of the shards
+ * @param shard_size the size in bytes beyond which a new shard is started, 0 for one shard
+ * @return true if the archive is open, see errorString() otherwise
+ */
+bool ResultArchive::open(const QString &directory, const QString &prefix, qint64 shard_size)
+{
+    close();
+    m_directory = directory;
+    m_prefix = prefix;
+    m_shard_size = shard_size;
+    QStringList shards = QDir(directory).entryList(QStringList() << prefix + "-*.tar", QDir::Files, QDir::Name);
+    int last = -1;
+    for(const QString &shard : shards) {
+        bool ok = false;
+        int number = shard.mid(prefix.size() + 1, shard.size() - prefix.size() - 5).toInt(&ok);
+        if(ok) last = std::max(last, number);
+    }
+    return openShard(std::max(last, 0), last >= 0);
+}
+
+/**
+ * @brief ResultArchive::isOpen
+ * @return true if results are appended
+ */
+bool ResultArchive::isOpen() const
+{
+    return m_archive.isOpen();
+}
+
+/**
+ * @brief ResultArchive::append
+ *
+ * Appends a file to the current shard and records it in the index, a new shard is started
+ * if the current one would exceed shardSize().
+ *
+ * @param name the file name, unique within the archive
+ * @param data the file content
+ * @param digest the hex encoded sha1 of the content
+ * @return true if the file and its index line were written
+ */
+bool ResultArchive::append(const QString &name, const QByteArray &data, const QByteArray &digest)
+{
+    if(!isOpen()) {
+        m_error_string = "The archive is not open";
+        return false;
+    }
+    if(m_shard_size > 0 && m_archive.pos() > 0 && m_archive.pos() + 3 * TAR_BLOCK + padded(data.size()) > m_shard_size) {
+        close();
+        if(!openShard(m_shard + 1, false)) return false;
+    }
+    qint64 offset = 0;
+    if(!writeEntry(name, data, offset) || !m_archive.flush()) {
+        m_error_string = "Unable to write: " + m_archive.fileName();
+        return false;
+    }
+    QJsonObject entry{{"name", name},
+                      {"offset", offset},
+                      {"size", data.size()},
+                      {"sha1", QString::fromLatin1(digest)}};
+    QByteArray line = QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n";
+    if(m_index.write(line) != line.size() || !m_index.flush()) {
+        m_error_string = "Unable to write: " + m_index.fileName();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief ResultArchive::close
+ *
+ * Terminates the current shard with the end of archive blocks, a later open() continues it.
+ *
+ */
+void ResultArchive::close()
+{
+    if(!m_archive.isOpen()) return;
+    m_archive.write(QByteArray(2 * TAR_BLOCK, '\0'));
+    m_archive.close();
+    m_index.close();
+}
+
+/**
+ * @brief ResultArchive::fileName
+ * @return the path of the current shard
+ */
+QString ResultArchive::fileName() const
+{
+    return m_archive.fileName();
+}
+
+/**
+ * @brief ResultArchive::shardSize
+ * @return the size in bytes beyond which a new shard is started
+ */
+qint64 ResultArchive::shardSize() const
+{
+    return m_shard_size;
+}
+
+/**
+ * @brief ResultArchive::errorString
+ * @return a description of the last error
+ */
+QString ResultArchive::errorString() const
+{
+    return m_error_string;
+}
+
+/**
+ * @brief ResultArchive::readIndices
+ *
+ * Reads the indices of every archive in a directory, entries whose content is not
+ * completely within their shard are ignored.
+ *
+ * @param directory the directory of the shards
+ * @return the entries by file name
+ */
+QHash<QString, ResultArchive::Entry> ResultArchive::readIndices(const QString &directory)
+{
+    QHash<QString, Entry> entries;
+    QDir dir(directory);
+    for(const QString &index : dir.entryList(QStringList() << "*.idx", QDir::Files, QDir::Name)) {
+        QString archive = dir.absoluteFilePath(index.left(index.size() - 4) + ".tar");
+        qint64 archive_size = QFileInfo(archive).size();
+        QFile file(dir.absoluteFilePath(index));
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) continue;
+        while(!file.atEnd()) {
+            QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+            Entry entry{archive,
+                        (qint64)line["offset"].toDouble(),
+                        (qint64)line["size"].toDouble(),
+                        line["sha1"].toString().toLatin1()};
+            if(!line.contains("name") || entry.offset + entry.size > archive_size) continue;
+            entries.insert(line["name"].toString(), entry);
+        }
+    }
+    return entries;
+}
+
+/**
+ * @brief ResultArchive::read
+ * @param entry an entry of readIndices()
+ * @return the content of the file, empty if it can not be read
+ */
+QByteArray ResultArchive::read(const Entry &entry)
+{
+    QFile file(entry.archive);
+    if(!file.open(QIODevice::ReadOnly) || !file.seek(entry.offset)) return QByteArray();
+    QByteArray data = file.read(entry.size);
+    return data.size() == entry.size ? data : QByteArray();
+}
+
+/**
+ * @brief ResultArchive::openShard
+ *
+ * A private convenience method opening a shard and its index. A recovered shard is cut
+ * after its last indexed file, which drops the end of archive blocks as well as content
+ * written after the last index line, and index lines without content are removed.
+ *
+ * @param number the number of the shard
+ * @param recover true to continue an existing shard, false to start it empty
+ * @return true if the shard is open
+ */
+bool ResultArchive::openShard(int number, bool recover)
+{
+    m_shard = number;
+    m_archive.setFileName(shardPath(number, ".tar"));
+    m_index.setFileName(shardPath(number, ".idx"));
+    qint64 end = 0;
+    if(recover) {
+        qint64 archive_size = QFileInfo(m_archive.fileName()).size();
+        QByteArray kept;
+        bool dropped = false;
+        if(m_index.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            while(!m_index.atEnd()) {
+                QByteArray line = m_index.readLine();
+                QJsonObject entry = QJsonDocument::fromJson(line).object();
+                qint64 entry_end = (qint64)entry["offset"].toDouble() + padded((qint64)entry["size"].toDouble());
+                if(!entry.contains("name") || entry_end > archive_size) {
+                    dropped = true;
+                    continue;
+                }
+                kept += line.endsWith('\n') ? line : line + "\n";
+                end = std::max(end, entry_end);
+            }
+            m_index.close();
+        }
+        if(dropped) {
+            QSaveFile index(m_index.fileName());
+            if(!index.open(QIODevice::WriteOnly | QIODevice::Text) || index.write(kept) != kept.size() || !index.commit()) {
+                m_error_string = "Unable to write: " + m_index.fileName();
+                return false;
+            }
+        }
+    }
+    if(!m_archive.open(QIODevice::ReadWrite) || !m_archive.resize(end) || !m_archive.seek(end)) {
+        m_error_string = "Unable to open: " + m_archive.fileName();
+        m_archive.close();
+        return false;
+    }
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Text;
+    if(!m_index.open(recover ? mode | QIODevice::Append : mode | QIODevice::Truncate)) {
+        m_error_string = "Unable to open: " + m_index.fileName();
+        m_archive.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief ResultArchive::writeEntry
+ *
+ * A private convenience method writing the headers, content and padding of a file at the
+ * end of the current shard.
+ *
+ * @param name the file name
+ * @param data the file content
+ * @param offset the position of the content within the shard
+ * @return true if everything was written
+ */
+bool ResultArchive::writeEntry(const QString &name, const QByteArray &data, qint64 &offset)
+{
+    QByteArray utf8 = name.toUtf8();
+    QByteArray blocks;
+    if(utf8.size() > TAR_NAME_SIZE) {
+        // a pax record "<length> path=<name>\n" counts the digits of its own length
+        QByteArray record = " path=" + utf8 + "\n";
+        int length = record.size() + 1;
+        while(QByteArray::number(length).size() + record.size() != length) ++length;
+        record.prepend(QByteArray::number(length));
+        blocks += header("PaxHeader/" + utf8.left(TAR_NAME_SIZE - 10), record.size(), 'x');
+        blocks += record + QByteArray(padded(record.size()) - record.size(), '\0');
+    }
+    blocks += header(utf8.left(TAR_NAME_SIZE), data.size(), '0');
+    offset = m_archive.pos() + blocks.size();
+    blocks += data + QByteArray(padded(data.size()) - data.size(), '\0');
+    return m_archive.write(blocks) == blocks.size();
+}
+
+/**
+ * @brief ResultArchive::shardPath
+ * @param number the number of a shard
+ * @param suffix ".tar" or ".idx"
+ * @return the path of the shard or its index
+ */
+QString ResultArchive::shardPath(int number, const QString &suffix) const
+{
+    return m_directory + "/" + m_prefix + "-" + QString::number(number).rightJustified(SHARD_DIGITS, '0') + suffix;
+}
+
+/**
+ * @brief ResultArchive::header
+ * @param name the file name, at most TAR_NAME_SIZE bytes
+ * @param size the size of the content
+ * @param type the ustar type flag, '0' for a file or 'x' for pax records
+ * @return the ustar header block
+ */
+QByteArray ResultArchive::header(const QByteArray &name, qint64 size, char type)
+{
+    QByteArray block(TAR_BLOCK, '\0');
+    char *h = block.data();
+    std::memcpy(h, name.constData(), std::min(name.size(), TAR_NAME_SIZE));
+    std::memcpy(h + 100, "0000644", 7);                          // mode
+    std::memcpy(h + 108, "0000000", 7);                          // uid
+    std::memcpy(h + 116, "0000000", 7);                          // gid
+    std::memcpy(h + 124, octal(size, 11).constData(), 11);      // size
+    std::memcpy(h + 136, octal(QDateTime::currentMSecsSinceEpoch() / 1000, 11).constData(), 11);
+    h[156] = type;
+    std::memcpy(h + 257, "ustar", 6);                            // magic, NUL terminated
+    std::memcpy(h + 263, "00", 2);                               // version
+    std::memset(h + 148, ' ', 8);                                // the checksum counts as blanks
+    unsigned int checksum = 0;
+    for(int i = 0; i < TAR_BLOCK; ++i) checksum += (unsigned char)h[i];
+    std::memcpy(h + 148, octal(checksum, 6).constData(), 6);
+    h[154] = '\0';
+    return block;
+}
+}
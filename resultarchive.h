@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+namespace fmg {
+/**
+ * @brief The ResultArchive class
+ *
+ * Packs the results of a job into a few large tar files rather than one file per result.
+ * The results are appended sequentially to shard files <prefix>-0000.tar, <prefix>-0001.tar,
+ * ..., a new shard is started once a shard exceeds shardSize() bytes. Every shard has a
+ * sidecar index <prefix>-0000.idx of json lines:
+ *
+ *   {"name": "a_b_key.jpg", "offset": 1024, "size": 52311, "sha1": "..."}
+ *
+ * where offset is the position of the file content within the tar, such that a single
+ * result is read with one seek, see readIndices() and read(). The shards are plain ustar
+ * archives readable by tar, names longer than the ustar limit are stored in pax headers.
+ *
+ * An index line is written once the content is flushed. Opening an existing prefix drops
+ * whatever a crash left behind the last indexed result and appends from there, close()
+ * terminates the current shard.
+ */
+class ResultArchive
+{
+public:
+    struct Entry {
+        QString archive; // the path of the shard file
+        qint64 offset;
+        qint64 size;
+        QByteArray digest;
+    };
+
+    ResultArchive();
+    ~ResultArchive();
+
+    bool open(const QString &directory, const QString &prefix, qint64 shard_size);
+    bool isOpen() const;
+    bool append(const QString &name, const QByteArray &data, const QByteArray &digest);
+    void close();
+    QString fileName() const;
+    qint64 shardSize() const;
+    QString errorString() const;
+
+    static QHash<QString, Entry> readIndices(const QString &directory);
+    static QByteArray read(const Entry &entry);
+
+private:
+    bool openShard(int number, bool recover);
+    bool writeEntry(const QString &name, const QByteArray &data, qint64 &offset);
+    QString shardPath(int number, const QString &suffix) const;
+    static QByteArray header(const QByteArray &name, qint64 size, char type);
+
+private:
+    QString m_directory;
+    QString m_prefix;
+    qint64 m_shard_size;
+    int m_shard;
+    QFile m_archive;
+    QFile m_index;
+    QString m_error_string;
+};
+}